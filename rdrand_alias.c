@@ -0,0 +1,296 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.2
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+#include <math.h>
+#include <stdlib.h>
+#include "rdrand_alias.h"
+
+
+
+//Number of 64-bit random numbers rdrand_alias_sample_batch() fetches at once
+#define ALIAS_BATCH_WORDS 64
+
+//2^64 as a double, used to turn probabilities into 64-bit thresholds
+#define TWO_TO_THE_64 18446744073709551616.0
+
+
+struct rdrand_alias_table
+{
+	int capacity; //largest number of weights the table can hold
+	int size; //number of weights the table was last built from, 0 until it is built
+
+	//column i keeps its own index when the low half of the product is below threshold[i],
+	//and gives alias[i] otherwise
+	unsigned long long* threshold;
+	int* alias;
+
+	//scratch space used while building, kept so rebuilding never allocates
+	double* scaled;
+	int* worklist;
+};
+
+
+//Allocates an empty table that can hold up to "capacity" weights.
+//Returns NULL if "capacity" is not positive or the memory could not be allocated
+rdrand_alias_table* rdrand_alias_create(int capacity)
+{
+	rdrand_alias_table* table;
+
+	if(capacity <= 0)
+	{
+		return NULL;
+	}
+
+	table = malloc(sizeof(rdrand_alias_table));
+
+	if(NULL == table)
+	{
+		return NULL;
+	}
+
+	table->capacity = capacity;
+	table->size = 0;
+	table->threshold = malloc(capacity * sizeof(unsigned long long));
+	table->alias = malloc(capacity * sizeof(int));
+	table->scaled = malloc(capacity * sizeof(double));
+	table->worklist = malloc(capacity * sizeof(int));
+
+	if(NULL == table->threshold || NULL == table->alias || NULL == table->scaled || NULL == table->worklist)
+	{
+		rdrand_alias_free(table);
+		return NULL;
+	}
+
+	return table;
+}
+
+//Builds the table from "numberOfWeights" weights, replacing whatever it held before.
+//Nothing is allocated, so this is safe to call every time the weights change.
+//Weights must be finite and not negative, and at least one must be positive.
+//Returns 1 if successful, 0 if the weights are not valid or do not fit in the table
+int rdrand_alias_build(rdrand_alias_table* table, const double* weights, int numberOfWeights)
+{
+	int i;
+	int small_count = 0;
+	int large_start;
+	int small;
+	int large;
+	double sum = 0.0;
+	double* scaled = table->scaled;
+	int* worklist = table->worklist;
+
+	if(numberOfWeights <= 0 || numberOfWeights > table->capacity)
+	{
+		return RDRAND_FAIL;
+	}
+
+	for( i = 0; i < numberOfWeights; i++ )
+	{
+		if(!isfinite(weights[i]) || weights[i] < 0.0)
+		{
+			return RDRAND_FAIL;
+		}
+
+		sum += weights[i];
+	}
+
+	if(!(sum > 0.0) || !isfinite(sum))
+	{
+		return RDRAND_FAIL;
+	}
+
+	//scale the weights so that they average 1. Columns below 1 are "small" and are
+	//kept at the front of the worklist, columns of 1 or more are "large" and kept at the back
+	large_start = numberOfWeights;
+
+	for( i = 0; i < numberOfWeights; i++ )
+	{
+		scaled[i] = weights[i] * numberOfWeights / sum;
+
+		if(scaled[i] < 1.0)
+		{
+			worklist[small_count++] = i;
+		}
+
+		else
+		{
+			worklist[--large_start] = i;
+		}
+	}
+
+	//each small column is topped up to 1 with probability taken from a large column
+	while(small_count > 0 && large_start < numberOfWeights)
+	{
+		small = worklist[--small_count];
+		large = worklist[large_start++];
+
+		table->threshold[small] = (unsigned long long) (scaled[small] * TWO_TO_THE_64);
+		table->alias[small] = large;
+
+		scaled[large] = (scaled[large] + scaled[small]) - 1.0;
+
+		if(scaled[large] < 1.0)
+		{
+			worklist[small_count++] = large;
+		}
+
+		else
+		{
+			worklist[--large_start] = large;
+		}
+	}
+
+	//whatever is left is full up to rounding error, and always keeps its own index
+	while(large_start < numberOfWeights)
+	{
+		large = worklist[large_start++];
+		table->threshold[large] = ~0ULL;
+		table->alias[large] = large;
+	}
+
+	while(small_count > 0)
+	{
+		small = worklist[--small_count];
+		table->threshold[small] = ~0ULL;
+		table->alias[small] = small;
+	}
+
+	table->size = numberOfWeights;
+
+	return RDRAND_SUCCESS;
+}
+
+//Turns one 64-bit random number into an index: the high half of word * size picks
+//the column and the low half decides between the column and its alias
+static inline int alias_pick64(const rdrand_alias_table* table, unsigned long long word)
+{
+	unsigned __int128 product = (unsigned __int128) word * (unsigned int) table->size;
+	int column = (int) (product >> 64);
+
+	return (unsigned long long) product < table->threshold[column] ? column : table->alias[column];
+}
+
+//The same as alias_pick64() using only 32 random bits, for small tables
+static inline int alias_pick32(const rdrand_alias_table* table, unsigned int half)
+{
+	unsigned long long product = (unsigned long long) half * (unsigned int) table->size;
+	int column = (int) (product >> 32);
+
+	return (unsigned int) product < (unsigned int) (table->threshold[column] >> 32) ? column : table->alias[column];
+}
+
+//Picks one index from the table and stores it in "index". Returns 1 if successful, 0 if unsuccessful
+int rdrand_alias_sample(const rdrand_alias_table* table, int* index)
+{
+	unsigned long long word;
+
+	if(0 == table->size)
+	{
+		return RDRAND_FAIL;
+	}
+
+	if(RDRAND_FAIL == rdrand_getRandom64((long long int*) &word))
+	{
+		return RDRAND_FAIL;
+	}
+
+	*index = alias_pick64(table, word);
+
+	return RDRAND_SUCCESS;
+}
+
+//Fills "dest" with "numberOfElements" indexes picked from the table. Random numbers are
+//fetched in blocks, and split in two for tables of up to RDRAND_ALIAS_SPLIT_LIMIT entries.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_alias_sample_batch(const rdrand_alias_table* table, int* dest, int numberOfElements)
+{
+	unsigned long long words[ALIAS_BATCH_WORDS];
+	int split = table->size <= RDRAND_ALIAS_SPLIT_LIMIT;
+	int picks_per_block = split ? 2 * ALIAS_BATCH_WORDS : ALIAS_BATCH_WORDS;
+	int picks;
+	int needed_words;
+	int i;
+
+	if(0 == table->size)
+	{
+		return RDRAND_FAIL;
+	}
+
+	while(numberOfElements > 0)
+	{
+		picks = numberOfElements < picks_per_block ? numberOfElements : picks_per_block;
+		needed_words = split ? (picks + 1) / 2 : picks;
+
+		if(RDRAND_FAIL == fill_buffer_qint_rdrand((long long int*) words, needed_words))
+		{
+			return RDRAND_FAIL;
+		}
+
+		if(split)
+		{
+			for( i = 0; i < picks; i++ )
+			{
+				dest[i] = alias_pick32(table, (unsigned int) (words[i / 2] >> (32 * (i & 1))));
+			}
+		}
+
+		else
+		{
+			for( i = 0; i < picks; i++ )
+			{
+				dest[i] = alias_pick64(table, words[i]);
+			}
+		}
+
+		dest += picks;
+		numberOfElements -= picks;
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Frees a table made by rdrand_alias_create()
+void rdrand_alias_free(rdrand_alias_table* table)
+{
+	if(NULL == table)
+	{
+		return;
+	}
+
+	free(table->threshold);
+	free(table->alias);
+	free(table->scaled);
+	free(table->worklist);
+	free(table);
+}
@@ -0,0 +1,79 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.1
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef RDRAND_ALIAS_H
+#define RDRAND_ALIAS_H
+
+#include "rdrandlib.h"
+
+
+//An alias table picks index i out of 0 to k - 1 with probability weights[i] / sum(weights),
+//using one 64-bit random number per pick no matter how large k is (Walker/Vose alias method).
+//
+//Each pick multiplies the random number by k. The high 64 bits of the product choose a
+//column of the table, and the low 64 bits are compared against that column's threshold to
+//choose between the column itself and its alias. The result is off from the exact weights
+//by at most k / 2^64.
+
+
+//When the table has at most this many entries, rdrand_alias_sample_batch() gets two picks
+//out of every 64-bit random number, which moves the probabilities by at most k / 2^32
+#define RDRAND_ALIAS_SPLIT_LIMIT 256
+
+typedef struct rdrand_alias_table rdrand_alias_table;
+
+
+//Allocates an empty table that can hold up to "capacity" weights.
+//Returns NULL if "capacity" is not positive or the memory could not be allocated
+rdrand_alias_table* rdrand_alias_create(int capacity);
+
+//Builds the table from "numberOfWeights" weights, replacing whatever it held before.
+//Nothing is allocated, so this is safe to call every time the weights change.
+//Weights must be finite and not negative, and at least one must be positive.
+//Returns 1 if successful, 0 if the weights are not valid or do not fit in the table
+int rdrand_alias_build(rdrand_alias_table* table, const double* weights, int numberOfWeights);
+
+//Picks one index from the table and stores it in "index". Returns 1 if successful, 0 if unsuccessful
+int rdrand_alias_sample(const rdrand_alias_table* table, int* index);
+
+//Fills "dest" with "numberOfElements" indexes picked from the table. Random numbers are
+//fetched in blocks, and split in two for tables of up to RDRAND_ALIAS_SPLIT_LIMIT entries.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_alias_sample_batch(const rdrand_alias_table* table, int* dest, int numberOfElements);
+
+//Frees a table made by rdrand_alias_create()
+void rdrand_alias_free(rdrand_alias_table* table);
+
+#endif
@@ -0,0 +1,789 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.2
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+#include <emmintrin.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rdrand_bulk.h"
+
+
+
+//Largest number of bytes handed to rdrand_get_bytes() at once, since it takes an int
+#define BULK_MAX_SIMPLE_CHUNK (1 << 30)
+
+//Bounds on the size of the buffer filled by each calibration run
+#define CALIBRATE_MIN_SAMPLE_BYTES (64 * 1024)
+#define CALIBRATE_MAX_SAMPLE_BYTES (16 * 1024 * 1024)
+
+//Each calibration run is sized to take about this fraction of the time budget
+#define CALIBRATE_RUNS_PER_BUDGET 16
+
+//Number of 64-bit RDRAND calls timed to measure latency
+#define CALIBRATE_LATENCY_CALLS 4096
+
+//More threads or a different chunk size must be at least this much faster to be chosen
+#define CALIBRATE_MIN_GAIN 1.05
+
+//Largest length of the "key=value" lines in the cache file
+#define CACHE_LINE_LENGTH 512
+
+
+//global variables
+static struct rdrand_bulk_profile current_profile = { RDRAND_BULK_UNROLLED, 1, RDRAND_BULK_DEFAULT_CHUNK_BYTES, 0.0, 0.0 };
+
+//guards "current_profile", so a fill on one thread never sees half of a profile set on another
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+//Everything the threads of one rdrand_bulk_fill() call share
+struct bulk_job
+{
+	unsigned char* dest;
+	size_t bytes;
+	size_t chunk_bytes;
+	int strategy;
+	atomic_size_t next_offset;
+	atomic_int failed;
+};
+
+
+//Runs the 64-bit rdrand instruction, retrying up to DEFAULT_RETRY_LIMIT times.
+//The result stays in a register so the unrolled loops can store it wherever they like.
+//Returns 1 if successful, 0 if unsuccessful
+static inline int rdrand64_retry(unsigned long long* randomNumber)
+{
+	int i;
+	unsigned char success;
+	unsigned long long temp;
+
+	for( i = 0; i < DEFAULT_RETRY_LIMIT; i++ )
+	{
+		asm volatile("rdrand %0 ; setc %1"
+
+		    : "=r" (temp), "=qm" (success));
+
+		if(success)
+		{
+			*randomNumber = temp;
+			return RDRAND_SUCCESS;
+		}
+	}
+
+	return RDRAND_FAIL;
+}
+
+//Fills the buffer with rdrand_get_bytes(), which only accepts an int length
+static int fill_simple(unsigned char* dest, size_t bytes)
+{
+	size_t chunk;
+
+	while(bytes > 0)
+	{
+		chunk = bytes < BULK_MAX_SIMPLE_CHUNK ? bytes : BULK_MAX_SIMPLE_CHUNK;
+
+		if(RDRAND_FAIL == rdrand_get_bytes(dest, (int) chunk))
+		{
+			return RDRAND_FAIL;
+		}
+
+		dest += chunk;
+		bytes -= chunk;
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Fills the buffer four 64-bit words at a time. With "nontemporal" set, the words
+//are written with movnti so they do not push the rest of the program out of the cache
+static int fill_unrolled(unsigned char* dest, size_t bytes, int nontemporal)
+{
+	unsigned long long a, b, c, d;
+	size_t head;
+
+	//non-temporal stores need the destination to be 8 byte aligned
+	if(nontemporal)
+	{
+		head = (8 - ((size_t) dest & 7)) & 7;
+		head = head < bytes ? head : bytes;
+
+		if(RDRAND_FAIL == rdrand_get_bytes(dest, (int) head))
+		{
+			return RDRAND_FAIL;
+		}
+
+		dest += head;
+		bytes -= head;
+	}
+
+	while(bytes >= 32)
+	{
+		if(RDRAND_FAIL == rdrand64_retry(&a) || RDRAND_FAIL == rdrand64_retry(&b)
+			|| RDRAND_FAIL == rdrand64_retry(&c) || RDRAND_FAIL == rdrand64_retry(&d))
+		{
+			return RDRAND_FAIL;
+		}
+
+		if(nontemporal)
+		{
+			_mm_stream_si64((long long*) dest, a);
+			_mm_stream_si64((long long*) (dest + 8), b);
+			_mm_stream_si64((long long*) (dest + 16), c);
+			_mm_stream_si64((long long*) (dest + 24), d);
+		}
+
+		else
+		{
+			memcpy(dest, &a, 8);
+			memcpy(dest + 8, &b, 8);
+			memcpy(dest + 16, &c, 8);
+			memcpy(dest + 24, &d, 8);
+		}
+
+		dest += 32;
+		bytes -= 32;
+	}
+
+	if(nontemporal)
+	{
+		//make the non-temporal stores visible before anybody else reads the buffer
+		_mm_sfence();
+	}
+
+	//the last few bytes go through the regular path
+	return rdrand_get_bytes(dest, (int) bytes);
+}
+
+static int fill_with_strategy(unsigned char* dest, size_t bytes, int strategy)
+{
+	switch(strategy)
+	{
+		case RDRAND_BULK_UNROLLED:
+			return fill_unrolled(dest, bytes, 0);
+
+		case RDRAND_BULK_NONTEMPORAL:
+			return fill_unrolled(dest, bytes, 1);
+
+		default:
+			return fill_simple(dest, bytes);
+	}
+}
+
+//Each thread keeps taking the next unclaimed chunk of the buffer until none are left
+static void* bulk_worker(void* arg)
+{
+	struct bulk_job* job = arg;
+	size_t offset;
+	size_t length;
+
+	for(;;)
+	{
+		offset = atomic_fetch_add_explicit(&job->next_offset, job->chunk_bytes, memory_order_relaxed);
+
+		if(offset >= job->bytes || atomic_load_explicit(&job->failed, memory_order_relaxed))
+		{
+			break;
+		}
+
+		length = job->bytes - offset < job->chunk_bytes ? job->bytes - offset : job->chunk_bytes;
+
+		if(RDRAND_FAIL == fill_with_strategy(job->dest + offset, length, job->strategy))
+		{
+			atomic_store_explicit(&job->failed, 1, memory_order_relaxed);
+		}
+	}
+
+	return NULL;
+}
+
+//Fills the buffer using "profile" rather than the current tuning profile
+static int fill_with_profile(void* dest, size_t bytes, const struct rdrand_bulk_profile* profile)
+{
+	pthread_t workers[RDRAND_BULK_MAX_THREADS];
+	struct bulk_job job;
+	size_t chunks;
+	int threads = profile->threads;
+	int started;
+
+	chunks = (bytes + profile->chunk_bytes - 1) / profile->chunk_bytes;
+
+	//small buffers are not worth starting threads for
+	if(threads <= 1 || chunks < 2)
+	{
+		return fill_with_strategy(dest, bytes, profile->strategy);
+	}
+
+	if((size_t) threads > chunks)
+	{
+		threads = (int) chunks;
+	}
+
+	job.dest = dest;
+	job.bytes = bytes;
+	job.chunk_bytes = profile->chunk_bytes;
+	job.strategy = profile->strategy;
+	atomic_init(&job.next_offset, 0);
+	atomic_init(&job.failed, 0);
+
+	//the calling thread does its share of the work too
+	for(started = 0; started < threads - 1; started++)
+	{
+		if(0 != pthread_create(&workers[started], NULL, bulk_worker, &job))
+		{
+			break;
+		}
+	}
+
+	bulk_worker(&job);
+
+	while(started > 0)
+	{
+		pthread_join(workers[--started], NULL);
+	}
+
+	return atomic_load(&job.failed) ? RDRAND_FAIL : RDRAND_SUCCESS;
+}
+
+//Fills "dest" with "bytes" random bytes using the current tuning profile.
+//Buffers of at least two chunks are split across the profile's threads.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_bulk_fill(void* dest, size_t bytes)
+{
+	struct rdrand_bulk_profile profile;
+
+	pthread_mutex_lock(&profile_lock);
+	profile = current_profile;
+	pthread_mutex_unlock(&profile_lock);
+
+	return fill_with_profile(dest, bytes, &profile);
+}
+
+//Applies RDRAND output to a few bytes at a time, one random word per 8 bytes.
+//With "mask" set the random bytes are XORed into "dest", otherwise they replace it
+static int apply_random_bytes(unsigned char* dest, size_t bytes, int mask)
+{
+	unsigned long long word;
+	size_t i;
+
+	while(bytes > 0)
+	{
+		if(RDRAND_FAIL == rdrand64_retry(&word))
+		{
+			return RDRAND_FAIL;
+		}
+
+		for( i = 0; i < 8 && i < bytes; i++ )
+		{
+			dest[i] = (mask ? dest[i] : 0) ^ (unsigned char) (word >> (8 * i));
+		}
+
+		dest += i;
+		bytes -= i;
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Applies RDRAND output to the whole buffer in a single pass, without a temporary buffer.
+//The aligned middle of the buffer is done 32 bytes at a time with SSE2 loads and stores,
+//which are non-temporal for buffers of at least RDRAND_SCRUB_NONTEMPORAL_BYTES
+static int apply_random(unsigned char* dest, size_t bytes, int mask)
+{
+	unsigned long long a, b, c, d;
+	__m128i low;
+	__m128i high;
+	size_t head;
+	int nontemporal = bytes >= RDRAND_SCRUB_NONTEMPORAL_BYTES;
+
+	head = (16 - ((size_t) dest & 15)) & 15;
+	head = head < bytes ? head : bytes;
+
+	if(RDRAND_FAIL == apply_random_bytes(dest, head, mask))
+	{
+		return RDRAND_FAIL;
+	}
+
+	dest += head;
+	bytes -= head;
+
+	while(bytes >= 32)
+	{
+		if(RDRAND_FAIL == rdrand64_retry(&a) || RDRAND_FAIL == rdrand64_retry(&b)
+			|| RDRAND_FAIL == rdrand64_retry(&c) || RDRAND_FAIL == rdrand64_retry(&d))
+		{
+			return RDRAND_FAIL;
+		}
+
+		low = _mm_set_epi64x(b, a);
+		high = _mm_set_epi64x(d, c);
+
+		if(mask)
+		{
+			low = _mm_xor_si128(low, _mm_load_si128((__m128i*) dest));
+			high = _mm_xor_si128(high, _mm_load_si128((__m128i*) (dest + 16)));
+		}
+
+		if(nontemporal)
+		{
+			_mm_stream_si128((__m128i*) dest, low);
+			_mm_stream_si128((__m128i*) (dest + 16), high);
+		}
+
+		else
+		{
+			_mm_store_si128((__m128i*) dest, low);
+			_mm_store_si128((__m128i*) (dest + 16), high);
+		}
+
+		dest += 32;
+		bytes -= 32;
+	}
+
+	if(nontemporal)
+	{
+		_mm_sfence();
+	}
+
+	return apply_random_bytes(dest, bytes, mask);
+}
+
+//XORs "bytes" random bytes into "buf" in place, for masking a buffer or turning it into a
+//one-time pad. The random numbers go straight from RDRAND into registers, so no second buffer
+//is needed. Returns 1 if successful, 0 if unsuccessful, in which case part of "buf" may be masked
+int rdrand_xor_into(void* buf, size_t bytes)
+{
+	int success = apply_random(buf, bytes, 1);
+
+	//tell the compiler the buffer is used afterwards, so the stores can not be dropped
+	asm volatile("" : : "r" (buf) : "memory");
+
+	return success;
+}
+
+//Overwrites "buf" with random bytes "passes" times, for scrubbing memory before it is freed.
+//The stores are never optimized away, even if "buf" is not read again.
+//Returns 1 if successful, 0 if unsuccessful or if "passes" is less than 1
+int rdrand_overwrite(void* buf, size_t bytes, int passes)
+{
+	int i;
+	int success = passes >= 1 ? RDRAND_SUCCESS : RDRAND_FAIL;
+
+	for( i = 0; i < passes && RDRAND_SUCCESS == success; i++ )
+	{
+		success = apply_random(buf, bytes, 0);
+
+		//every pass has to reach memory, not just the last one
+		asm volatile("" : : "r" (buf) : "memory");
+	}
+
+	return success;
+}
+
+//Copies the current tuning profile into "profile"
+void rdrand_bulk_get_profile(struct rdrand_bulk_profile* profile)
+{
+	pthread_mutex_lock(&profile_lock);
+	*profile = current_profile;
+	pthread_mutex_unlock(&profile_lock);
+}
+
+//Makes "profile" the current tuning profile. Returns 1 if successful, 0 if the profile is not valid
+int rdrand_bulk_set_profile(const struct rdrand_bulk_profile* profile)
+{
+	if(profile->strategy < RDRAND_BULK_SIMPLE || profile->strategy > RDRAND_BULK_NONTEMPORAL
+		|| profile->threads < 1 || profile->threads > RDRAND_BULK_MAX_THREADS
+		|| profile->chunk_bytes < 64)
+	{
+		return RDRAND_FAIL;
+	}
+
+	pthread_mutex_lock(&profile_lock);
+	current_profile = *profile;
+	pthread_mutex_unlock(&profile_lock);
+
+	return RDRAND_SUCCESS;
+}
+
+
+
+
+//Returns a monotonic time stamp in nanoseconds
+static long long now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+//Runs the CPUID instruction for "leaf" and stores the four result registers in "regs"
+static void cpuid(unsigned int leaf, unsigned int regs[4])
+{
+	asm volatile("cpuid"
+				: "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+				: "a" (leaf), "c" (0)
+				);
+}
+
+//Builds the string that identifies this machine in the cache file. It is made of the
+//CPU vendor, the family/model/stepping signature, the brand string and the microcode revision
+static void get_cpu_key(char* key, size_t length)
+{
+	unsigned int regs[4];
+	char vendor[13];
+	char brand[49] = "";
+	char microcode[64] = "unknown";
+	char line[CACHE_LINE_LENGTH];
+	unsigned int signature;
+	unsigned int leaf;
+	FILE* cpuinfo;
+
+	cpuid(0, regs);
+	memcpy(vendor, &regs[1], 4);
+	memcpy(vendor + 4, &regs[3], 4);
+	memcpy(vendor + 8, &regs[2], 4);
+	vendor[12] = '\0';
+
+	cpuid(1, regs);
+	signature = regs[0];
+
+	cpuid(0x80000000, regs);
+
+	if(regs[0] >= 0x80000004)
+	{
+		for(leaf = 0; leaf < 3; leaf++)
+		{
+			cpuid(0x80000002 + leaf, regs);
+			memcpy(brand + leaf * 16, regs, 16);
+		}
+
+		brand[48] = '\0';
+	}
+
+	//the microcode revision is only reported by the kernel
+	cpuinfo = fopen("/proc/cpuinfo", "r");
+
+	if(cpuinfo != NULL)
+	{
+		while(fgets(line, sizeof(line), cpuinfo) != NULL)
+		{
+			if(0 == strncmp(line, "microcode", 9) && 1 == sscanf(line, "microcode : %63s", microcode))
+			{
+				break;
+			}
+		}
+
+		fclose(cpuinfo);
+	}
+
+	snprintf(key, length, "%s|%08x|%s|%s", vendor, signature, brand, microcode);
+}
+
+//Returns the speed of filling "sample" with "profile", in megabytes per second, or 0 if RDRAND failed
+static double measure_profile(unsigned char* sample, size_t sampleBytes, const struct rdrand_bulk_profile* profile)
+{
+	long long start;
+	long long elapsed;
+
+	start = now_ns();
+
+	if(RDRAND_FAIL == fill_with_profile(sample, sampleBytes, profile))
+	{
+		return 0.0;
+	}
+
+	elapsed = now_ns() - start;
+
+	return (double) sampleBytes * 1000.0 / (double) (elapsed > 0 ? elapsed : 1);
+}
+
+//Writes "profile" and the key of the machine it was measured on into "cacheFile".
+//The profile is written to a temporary file first, so readers never see half of it
+static int write_cache(const char* cacheFile, const char* key, const struct rdrand_bulk_profile* profile)
+{
+	char temporary[CACHE_LINE_LENGTH];
+	FILE* cache;
+	int written;
+
+	snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", cacheFile, (long) getpid());
+
+	cache = fopen(temporary, "w");
+
+	if(NULL == cache)
+	{
+		return RDRAND_FAIL;
+	}
+
+	written = fprintf(cache, "key=%s\nstrategy=%d\nthreads=%d\nchunk_bytes=%d\nlatency_ns=%f\nthroughput_mbps=%f\n",
+		key, profile->strategy, profile->threads, profile->chunk_bytes, profile->latency_ns, profile->throughput_mbps);
+
+	if(0 != fclose(cache) || written < 0 || 0 != rename(temporary, cacheFile))
+	{
+		remove(temporary);
+		return RDRAND_FAIL;
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Reads a profile out of "cacheFile". Returns 1 if the file holds a complete profile
+//measured on the machine identified by "key", 0 otherwise
+static int read_cache(const char* cacheFile, const char* key, struct rdrand_bulk_profile* profile)
+{
+	char line[CACHE_LINE_LENGTH];
+	char* value;
+	FILE* cache;
+	int key_matches = 0;
+	int fields = 0;
+
+	cache = fopen(cacheFile, "r");
+
+	if(NULL == cache)
+	{
+		return RDRAND_FAIL;
+	}
+
+	while(fgets(line, sizeof(line), cache) != NULL)
+	{
+		line[strcspn(line, "\n")] = '\0';
+		value = strchr(line, '=');
+
+		if(NULL == value)
+		{
+			continue;
+		}
+
+		*value++ = '\0';
+
+		if(0 == strcmp(line, "key"))
+		{
+			key_matches = (0 == strcmp(value, key));
+		}
+
+		else if(0 == strcmp(line, "strategy"))
+		{
+			fields += sscanf(value, "%d", &profile->strategy);
+		}
+
+		else if(0 == strcmp(line, "threads"))
+		{
+			fields += sscanf(value, "%d", &profile->threads);
+		}
+
+		else if(0 == strcmp(line, "chunk_bytes"))
+		{
+			fields += sscanf(value, "%d", &profile->chunk_bytes);
+		}
+
+		else if(0 == strcmp(line, "latency_ns"))
+		{
+			fields += sscanf(value, "%lf", &profile->latency_ns);
+		}
+
+		else if(0 == strcmp(line, "throughput_mbps"))
+		{
+			fields += sscanf(value, "%lf", &profile->throughput_mbps);
+		}
+	}
+
+	fclose(cache);
+
+	return (key_matches && 5 == fields) ? RDRAND_SUCCESS : RDRAND_FAIL;
+}
+
+//Measures RDRAND latency, the speed of each strategy, and how the speed scales with more threads,
+//then makes the fastest combination the current tuning profile. The measurements stop after
+//RDRAND_CALIBRATE_BUDGET_MS milliseconds no matter how far they got. If "cacheFile" is not NULL,
+//the profile is written there together with the CPU model and microcode revision it was measured on.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_bulk_calibrate(const char* cacheFile)
+{
+	static const int chunk_sizes[] = { 16384, 262144 };
+	struct rdrand_bulk_profile best = { RDRAND_BULK_SIMPLE, 1, RDRAND_BULK_DEFAULT_CHUNK_BYTES, 0.0, 0.0 };
+	struct rdrand_bulk_profile trial;
+	char key[CACHE_LINE_LENGTH];
+	unsigned char* sample;
+	unsigned long long word;
+	long long deadline;
+	long long start;
+	long long cpus;
+	double latency_ns;
+	double sample_bytes;
+	double speed;
+	int i;
+
+	if(RDRAND_NOT_SUPPORTED == Check_RDRAND_Support())
+	{
+		return RDRAND_FAIL;
+	}
+
+	start = now_ns();
+	deadline = start + RDRAND_CALIBRATE_BUDGET_MS * 1000000LL;
+
+	//latency of a single 64-bit RDRAND
+	for( i = 0; i < CALIBRATE_LATENCY_CALLS; i++ )
+	{
+		if(RDRAND_FAIL == rdrand64_retry(&word))
+		{
+			return RDRAND_FAIL;
+		}
+	}
+
+	latency_ns = (double) (now_ns() - start) / CALIBRATE_LATENCY_CALLS;
+
+	//size each run from the measured latency, so slow parts do not blow the time budget
+	sample_bytes = (RDRAND_CALIBRATE_BUDGET_MS * 1000000.0 / CALIBRATE_RUNS_PER_BUDGET) / latency_ns * 8.0;
+	sample_bytes = sample_bytes < CALIBRATE_MIN_SAMPLE_BYTES ? CALIBRATE_MIN_SAMPLE_BYTES : sample_bytes;
+	sample_bytes = sample_bytes > CALIBRATE_MAX_SAMPLE_BYTES ? CALIBRATE_MAX_SAMPLE_BYTES : sample_bytes;
+
+	sample = malloc((size_t) sample_bytes);
+
+	if(NULL == sample)
+	{
+		return RDRAND_FAIL;
+	}
+
+	//touch the sample once so page faults are not counted against the first strategy
+	memset(sample, 0, (size_t) sample_bytes);
+
+	//first pick the fastest strategy on a single thread
+	trial = best;
+
+	for( trial.strategy = RDRAND_BULK_SIMPLE; trial.strategy <= RDRAND_BULK_NONTEMPORAL && now_ns() < deadline; trial.strategy++ )
+	{
+		speed = measure_profile(sample, (size_t) sample_bytes, &trial);
+
+		if(speed > best.throughput_mbps)
+		{
+			best = trial;
+			best.throughput_mbps = speed;
+		}
+	}
+
+	//then keep doubling the thread count for as long as it keeps paying off
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	trial = best;
+
+	for( trial.threads = 2; trial.threads <= cpus && trial.threads <= RDRAND_BULK_MAX_THREADS && now_ns() < deadline; trial.threads *= 2 )
+	{
+		if((double) trial.threads * trial.chunk_bytes * 2 > sample_bytes)
+		{
+			break;
+		}
+
+		speed = measure_profile(sample, (size_t) sample_bytes, &trial);
+
+		if(speed < best.throughput_mbps * CALIBRATE_MIN_GAIN)
+		{
+			break;
+		}
+
+		best = trial;
+		best.throughput_mbps = speed;
+	}
+
+	//the chunk size only matters once more than one thread shares the buffer
+	trial = best;
+
+	for( i = 0; best.threads > 1 && i < (int) (sizeof(chunk_sizes) / sizeof(chunk_sizes[0])) && now_ns() < deadline; i++ )
+	{
+		trial.chunk_bytes = chunk_sizes[i];
+
+		if((double) trial.threads * trial.chunk_bytes * 2 > sample_bytes)
+		{
+			continue;
+		}
+
+		speed = measure_profile(sample, (size_t) sample_bytes, &trial);
+
+		if(speed > best.throughput_mbps * CALIBRATE_MIN_GAIN)
+		{
+			best = trial;
+			best.throughput_mbps = speed;
+		}
+	}
+
+	free(sample);
+
+	if(0.0 == best.throughput_mbps)
+	{
+		//RDRAND failed on every run
+		return RDRAND_FAIL;
+	}
+
+	best.latency_ns = latency_ns;
+	pthread_mutex_lock(&profile_lock);
+	current_profile = best;
+	pthread_mutex_unlock(&profile_lock);
+
+	if(cacheFile != NULL)
+	{
+		get_cpu_key(key, sizeof(key));
+		write_cache(cacheFile, key, &best);
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Loads the tuning profile stored in "cacheFile". The profile is only used if it was measured on
+//the same CPU model and microcode revision as this machine. Otherwise, if "calibrateIfMissing" is 1,
+//rdrand_bulk_calibrate() is run and its result is stored in "cacheFile".
+//Returns 1 if a profile was loaded or measured, 0 if the default profile is still in use
+int rdrand_bulk_init(const char* cacheFile, int calibrateIfMissing)
+{
+	struct rdrand_bulk_profile profile;
+	char key[CACHE_LINE_LENGTH];
+
+	if(cacheFile != NULL)
+	{
+		get_cpu_key(key, sizeof(key));
+
+		if(RDRAND_SUCCESS == read_cache(cacheFile, key, &profile) && RDRAND_SUCCESS == rdrand_bulk_set_profile(&profile))
+		{
+			return RDRAND_SUCCESS;
+		}
+	}
+
+	if(calibrateIfMissing)
+	{
+		return rdrand_bulk_calibrate(cacheFile);
+	}
+
+	return RDRAND_FAIL;
+}
@@ -0,0 +1,118 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.1
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef RDRAND_BULK_H
+#define RDRAND_BULK_H
+
+#include <stddef.h>
+#include "rdrandlib.h"
+
+
+//These are the different ways rdrand_bulk_fill() can fill a buffer
+
+//Calls rdrand_get_bytes()
+#define RDRAND_BULK_SIMPLE 0
+
+//Runs RDRAND four times per loop and stores the four results together
+#define RDRAND_BULK_UNROLLED 1
+
+//Like RDRAND_BULK_UNROLLED, but writes with non-temporal stores that bypass the cache.
+//This is usually the fastest way to fill buffers that are larger than the cache
+#define RDRAND_BULK_NONTEMPORAL 2
+
+
+//Number of bytes each thread takes at a time unless a tuning profile says otherwise
+#define RDRAND_BULK_DEFAULT_CHUNK_BYTES 65536
+
+//Largest number of threads rdrand_bulk_fill() will ever use
+#define RDRAND_BULK_MAX_THREADS 64
+
+//rdrand_xor_into() and rdrand_overwrite() switch to non-temporal stores for buffers of at least this many bytes
+#define RDRAND_SCRUB_NONTEMPORAL_BYTES (1024 * 1024)
+
+//Upper limit on how long rdrand_bulk_calibrate() spends measuring, in milliseconds
+#define RDRAND_CALIBRATE_BUDGET_MS 500
+
+
+//A tuning profile tells rdrand_bulk_fill() how to fill large buffers on this machine.
+//The current profile may be changed while other threads are filling buffers. Each fill
+//uses whichever profile was current when it started
+struct rdrand_bulk_profile
+{
+	int strategy; //one of the RDRAND_BULK_ strategies above
+	int threads; //number of threads to split large buffers across
+	int chunk_bytes; //number of bytes each thread takes at a time
+
+	//the measurements the choice was based on, zero if the profile was not measured
+	double latency_ns; //time taken by a single 64-bit RDRAND
+	double throughput_mbps; //rate of the chosen strategy, in megabytes per second
+};
+
+
+//Fills "dest" with "bytes" random bytes using the current tuning profile.
+//Buffers of at least two chunks are split across the profile's threads.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_bulk_fill(void* dest, size_t bytes);
+
+//XORs "bytes" random bytes into "buf" in place, for masking a buffer or turning it into a
+//one-time pad. The random numbers go straight from RDRAND into registers, so no second buffer
+//is needed. Returns 1 if successful, 0 if unsuccessful, in which case part of "buf" may be masked
+int rdrand_xor_into(void* buf, size_t bytes);
+
+//Overwrites "buf" with random bytes "passes" times, for scrubbing memory before it is freed.
+//The stores are never optimized away, even if "buf" is not read again.
+//Returns 1 if successful, 0 if unsuccessful or if "passes" is less than 1
+int rdrand_overwrite(void* buf, size_t bytes, int passes);
+
+//Copies the current tuning profile into "profile"
+void rdrand_bulk_get_profile(struct rdrand_bulk_profile* profile);
+
+//Makes "profile" the current tuning profile. Returns 1 if successful, 0 if the profile is not valid
+int rdrand_bulk_set_profile(const struct rdrand_bulk_profile* profile);
+
+//Measures RDRAND latency, the speed of each strategy, and how the speed scales with more threads,
+//then makes the fastest combination the current tuning profile. The measurements stop after
+//RDRAND_CALIBRATE_BUDGET_MS milliseconds no matter how far they got. If "cacheFile" is not NULL,
+//the profile is written there together with the CPU model and microcode revision it was measured on.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_bulk_calibrate(const char* cacheFile);
+
+//Loads the tuning profile stored in "cacheFile". The profile is only used if it was measured on
+//the same CPU model and microcode revision as this machine. Otherwise, if "calibrateIfMissing" is 1,
+//rdrand_bulk_calibrate() is run and its result is stored in "cacheFile".
+//Returns 1 if a profile was loaded or measured, 0 if the default profile is still in use
+int rdrand_bulk_init(const char* cacheFile, int calibrateIfMissing);
+
+#endif
@@ -0,0 +1,913 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.1
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+//This file builds an LD_PRELOAD library that serves getrandom(), getentropy(),
+//arc4random_buf() and read() on file descriptors opened from "/dev/urandom"
+//out of per-thread buffers filled by rdrand_get_bytes(), so that programs we
+//cannot modify stop paying a system call for every small getrandom() request.
+//
+//Usage:
+//	make librdrand_preload.so
+//	LD_PRELOAD=./librdrand_preload.so some_program
+//
+//If RDRAND is not supported, or if it fails, every call is passed on to the
+//real libc function. Only open(), open64() and openat() are watched, so
+//"/dev/urandom" streams opened through fopen() are still read through the
+//kernel. A forked child never reuses its parent's buffered bytes.
+//
+//A file descriptor number can be closed and reused behind our back, for
+//example by fclose() or a raw system call. So every function that creates or
+//closes descriptors is wrapped to forget the number, and before each read()
+//the descriptor is checked with fstat() to still be the urandom device. That
+//means read() still costs one system call per call, which is about what the
+//kernel's own small reads cost, so only getrandom(), getentropy() and
+//arc4random_buf() become cheaper. See the README for measurements.
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include "rdrandlib.h"
+
+
+
+//Size of each thread's buffer. It is one page so that it can be wiped on fork
+#define RDRAND_PRELOAD_POOL_PAGE 4096
+
+//Number of random bytes held in each thread's buffer
+#define RDRAND_PRELOAD_POOL_BYTES (RDRAND_PRELOAD_POOL_PAGE - 64)
+
+//Requests at least this large skip the buffer and are filled in place
+#define RDRAND_PRELOAD_DIRECT_BYTES RDRAND_PRELOAD_POOL_BYTES
+
+//Largest chunk handed to rdrand_get_bytes() at once, since it takes an int
+#define RDRAND_PRELOAD_MAX_CHUNK (1 << 30)
+
+//File descriptors above this number are never tracked as "/dev/urandom"
+#define RDRAND_PRELOAD_MAX_FD 4096
+
+//Device numbers of /dev/urandom
+#define URANDOM_MAJOR 1
+#define URANDOM_MINOR 9
+
+//getentropy() refuses requests larger than this, just like libc does
+#define RDRAND_PRELOAD_GETENTROPY_MAX 256
+
+
+//Each thread's buffer lives on its own page. The page is marked MADV_WIPEONFORK,
+//so a child process always starts with "left" equal to zero and can never hand
+//out the same bytes as its parent
+struct rdrand_pool
+{
+	int left; //number of unused bytes at the end of "bytes"
+	int wipe_on_fork; //1 if the kernel wipes this page in a forked child
+	unsigned char bytes[RDRAND_PRELOAD_POOL_BYTES] __attribute__((aligned(64)));
+};
+
+
+//pointers to the real libc functions
+static ssize_t (*real_getrandom)(void*, size_t, unsigned int);
+static int (*real_getentropy)(void*, size_t);
+static void (*real_arc4random_buf)(void*, size_t);
+static int (*real_open)(const char*, int, ...);
+static int (*real_open64)(const char*, int, ...);
+static int (*real_openat)(int, const char*, int, ...);
+static ssize_t (*real_read)(int, void*, size_t);
+static int (*real_close)(int);
+static int (*real_dup2)(int, int);
+static int (*real_dup3)(int, int, int);
+static int (*real_dup)(int);
+static int (*real_fcntl)(int, int, ...);
+static int (*real_fcntl64)(int, int, ...);
+static int (*real_creat)(const char*, mode_t);
+static int (*real_creat64)(const char*, mode_t);
+static int (*real_openat64)(int, const char*, int, ...);
+static int (*real_socket)(int, int, int);
+static int (*real_socketpair)(int, int, int, int*);
+static int (*real_accept)(int, struct sockaddr*, socklen_t*);
+static int (*real_accept4)(int, struct sockaddr*, socklen_t*, int);
+static int (*real_pipe)(int*);
+static int (*real_pipe2)(int*, int);
+static int (*real_eventfd)(unsigned int, int);
+static int (*real_memfd_create)(const char*, unsigned int);
+static int (*real_signalfd)(int, const void*, int);
+static int (*real_timerfd_create)(int, int);
+static int (*real_epoll_create)(int);
+static int (*real_epoll_create1)(int);
+static int (*real_inotify_init)(void);
+static int (*real_inotify_init1)(int);
+static FILE* (*real_fdopen)(int, const char*);
+static int (*real_close_range)(unsigned int, unsigned int, int);
+static void (*real_closefrom)(int);
+
+//global variables
+static pthread_once_t preload_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+static int rdrand_usable = 0;
+static unsigned char urandom_fds[RDRAND_PRELOAD_MAX_FD];
+static __thread struct rdrand_pool* thread_pool;
+static __thread volatile int thread_serving; //1 while preload_serve() is using this thread's buffer
+
+
+//Only the forking thread survives in the child, so dropping its buffer is enough
+//when the kernel was not able to wipe the page for us
+static void preload_atfork_child(void)
+{
+	if(thread_pool != NULL && !thread_pool->wipe_on_fork)
+	{
+		memset(thread_pool->bytes, 0, sizeof(thread_pool->bytes));
+		thread_pool->left = 0;
+	}
+}
+
+//Releases a thread's buffer when that thread exits. Other destructors may still ask
+//for random bytes after this one has run, so the thread must not keep pointing at
+//the unmapped page. It gets a fresh buffer if that happens
+static void preload_pool_destructor(void* pool)
+{
+	thread_pool = NULL;
+	memset(pool, 0, RDRAND_PRELOAD_POOL_PAGE);
+	munmap(pool, RDRAND_PRELOAD_POOL_PAGE);
+}
+
+//Looks up the real libc functions and checks for RDRAND support once per process
+static void preload_init(void)
+{
+	real_getrandom = dlsym(RTLD_NEXT, "getrandom");
+	real_getentropy = dlsym(RTLD_NEXT, "getentropy");
+	real_arc4random_buf = dlsym(RTLD_NEXT, "arc4random_buf");
+	real_open = dlsym(RTLD_NEXT, "open");
+	real_open64 = dlsym(RTLD_NEXT, "open64");
+	real_openat = dlsym(RTLD_NEXT, "openat");
+	real_read = dlsym(RTLD_NEXT, "read");
+	real_close = dlsym(RTLD_NEXT, "close");
+	real_dup2 = dlsym(RTLD_NEXT, "dup2");
+	real_dup3 = dlsym(RTLD_NEXT, "dup3");
+	real_dup = dlsym(RTLD_NEXT, "dup");
+	real_fcntl = dlsym(RTLD_NEXT, "fcntl");
+	real_fcntl64 = dlsym(RTLD_NEXT, "fcntl64");
+	real_creat = dlsym(RTLD_NEXT, "creat");
+	real_creat64 = dlsym(RTLD_NEXT, "creat64");
+	real_openat64 = dlsym(RTLD_NEXT, "openat64");
+	real_socket = dlsym(RTLD_NEXT, "socket");
+	real_socketpair = dlsym(RTLD_NEXT, "socketpair");
+	real_accept = dlsym(RTLD_NEXT, "accept");
+	real_accept4 = dlsym(RTLD_NEXT, "accept4");
+	real_pipe = dlsym(RTLD_NEXT, "pipe");
+	real_pipe2 = dlsym(RTLD_NEXT, "pipe2");
+	real_eventfd = dlsym(RTLD_NEXT, "eventfd");
+	real_memfd_create = dlsym(RTLD_NEXT, "memfd_create");
+	real_signalfd = dlsym(RTLD_NEXT, "signalfd");
+	real_timerfd_create = dlsym(RTLD_NEXT, "timerfd_create");
+	real_epoll_create = dlsym(RTLD_NEXT, "epoll_create");
+	real_epoll_create1 = dlsym(RTLD_NEXT, "epoll_create1");
+	real_inotify_init = dlsym(RTLD_NEXT, "inotify_init");
+	real_inotify_init1 = dlsym(RTLD_NEXT, "inotify_init1");
+	real_fdopen = dlsym(RTLD_NEXT, "fdopen");
+	real_close_range = dlsym(RTLD_NEXT, "close_range");
+	real_closefrom = dlsym(RTLD_NEXT, "closefrom");
+
+	if(0 != pthread_key_create(&pool_key, preload_pool_destructor))
+	{
+		return;
+	}
+
+	pthread_atfork(NULL, NULL, preload_atfork_child);
+
+	if(RDRAND_SUPPORTED == Check_RDRAND_Support())
+	{
+		rdrand_usable = 1;
+	}
+}
+
+static void __attribute__((constructor)) preload_constructor(void)
+{
+	pthread_once(&preload_once, preload_init);
+}
+
+//Returns the calling thread's buffer, creating it the first time through
+static struct rdrand_pool* get_thread_pool(void)
+{
+	struct rdrand_pool* pool = thread_pool;
+
+	if(pool != NULL)
+	{
+		return pool;
+	}
+
+	pool = mmap(NULL, RDRAND_PRELOAD_POOL_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(MAP_FAILED == pool)
+	{
+		return NULL;
+	}
+
+#ifdef MADV_WIPEONFORK
+	if(0 == madvise(pool, RDRAND_PRELOAD_POOL_PAGE, MADV_WIPEONFORK))
+	{
+		pool->wipe_on_fork = 1;
+	}
+#endif
+
+	pool->left = 0;
+	pthread_setspecific(pool_key, pool);
+	thread_pool = pool;
+
+	return pool;
+}
+
+//Copies up to "bytes" random bytes into "dest" from the thread's buffer,
+//refilling the buffer with RDRAND as needed. Every byte is erased from the
+//buffer once it has been handed out. Returns the number of bytes written,
+//which is less than "bytes" only if RDRAND failed.
+//getentropy() may be called from a signal handler that interrupted this very
+//function, between copying bytes out and marking them used. Such a nested call
+//serves nothing and leaves the request to the kernel, so no byte goes out twice
+static size_t preload_serve(void* dest, size_t bytes)
+{
+	struct rdrand_pool* pool;
+	unsigned char* out = dest;
+	size_t served = 0;
+	size_t chunk;
+
+	pthread_once(&preload_once, preload_init);
+
+	if(!rdrand_usable || thread_serving)
+	{
+		return 0;
+	}
+
+	thread_serving = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+	if(NULL == (pool = get_thread_pool()))
+	{
+		__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		thread_serving = 0;
+		return 0;
+	}
+
+	while(served < bytes)
+	{
+		//large requests are filled in place instead of going through the buffer
+		if(0 == pool->left && bytes - served >= RDRAND_PRELOAD_DIRECT_BYTES)
+		{
+			chunk = bytes - served;
+
+			if(chunk > RDRAND_PRELOAD_MAX_CHUNK)
+			{
+				chunk = RDRAND_PRELOAD_MAX_CHUNK;
+			}
+
+			if(RDRAND_FAIL == rdrand_get_bytes(out + served, (int) chunk))
+			{
+				break;
+			}
+
+			served += chunk;
+			continue;
+		}
+
+		if(0 == pool->left)
+		{
+			if(RDRAND_FAIL == rdrand_get_bytes(pool->bytes, RDRAND_PRELOAD_POOL_BYTES))
+			{
+				break;
+			}
+
+			pool->left = RDRAND_PRELOAD_POOL_BYTES;
+		}
+
+		chunk = bytes - served;
+
+		if(chunk > (size_t) pool->left)
+		{
+			chunk = pool->left;
+		}
+
+		//bytes are taken from the front of the unused region and erased right away
+		memcpy(out + served, pool->bytes + (RDRAND_PRELOAD_POOL_BYTES - pool->left), chunk);
+		memset(pool->bytes + (RDRAND_PRELOAD_POOL_BYTES - pool->left), 0, chunk);
+
+		pool->left -= (int) chunk;
+		served += chunk;
+	}
+
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	thread_serving = 0;
+
+	return served;
+}
+
+//Reads random bytes from the kernel without going through any of the wrappers in this file
+static ssize_t kernel_getrandom(void* buf, size_t buflen, unsigned int flags)
+{
+	if(real_getrandom != NULL)
+	{
+		return real_getrandom(buf, buflen, flags);
+	}
+
+	return syscall(SYS_getrandom, buf, buflen, flags);
+}
+
+//Remembers whether "fd" was opened from "/dev/urandom"
+static void track_fd(int fd, const char* pathname)
+{
+	if(fd >= 0 && fd < RDRAND_PRELOAD_MAX_FD)
+	{
+		__atomic_store_n(&urandom_fds[fd], (0 == strcmp(pathname, "/dev/urandom")), __ATOMIC_RELAXED);
+	}
+}
+
+static void untrack_fd(int fd)
+{
+	if(fd >= 0 && fd < RDRAND_PRELOAD_MAX_FD)
+	{
+		__atomic_store_n(&urandom_fds[fd], 0, __ATOMIC_RELAXED);
+	}
+}
+
+static int is_tracked_fd(int fd)
+{
+	return fd >= 0 && fd < RDRAND_PRELOAD_MAX_FD && __atomic_load_n(&urandom_fds[fd], __ATOMIC_RELAXED);
+}
+
+//Called with every descriptor handed out by a wrapped function. The number may have
+//belonged to "/dev/urandom" before, so it is forgotten. Returns "fd" unchanged
+static int new_fd(int fd)
+{
+	untrack_fd(fd);
+
+	return fd;
+}
+
+//A duplicate of a "/dev/urandom" descriptor reads from "/dev/urandom" too. Returns "newfd" unchanged
+static int copy_fd_mark(int oldfd, int newfd)
+{
+	if(newfd >= 0 && newfd < RDRAND_PRELOAD_MAX_FD)
+	{
+		__atomic_store_n(&urandom_fds[newfd], (unsigned char) is_tracked_fd(oldfd), __ATOMIC_RELAXED);
+	}
+
+	return newfd;
+}
+
+//Descriptors can still be closed and reused in ways we cannot see, such as fclose() or
+//a raw close system call, so a tracked descriptor is checked to really be the urandom
+//character device before random bytes are served for it. Returns 1 if it is
+static int is_still_urandom(int fd)
+{
+	struct stat info;
+
+	if(0 == fstat(fd, &info) && S_ISCHR(info.st_mode)
+		&& URANDOM_MAJOR == major(info.st_rdev) && URANDOM_MINOR == minor(info.st_rdev))
+	{
+		return 1;
+	}
+
+	untrack_fd(fd);
+
+	return 0;
+}
+
+
+
+
+ssize_t getrandom(void* buf, size_t buflen, unsigned int flags)
+{
+	size_t served;
+	ssize_t rest;
+
+	//GRND_RANDOM callers asked for the kernel's blocking pool specifically
+	if(flags & GRND_RANDOM)
+	{
+		pthread_once(&preload_once, preload_init);
+		return kernel_getrandom(buf, buflen, flags);
+	}
+
+	served = preload_serve(buf, buflen);
+
+	if(served == buflen)
+	{
+		return (ssize_t) buflen;
+	}
+
+	//RDRAND is unavailable or failed, so the kernel provides whatever is left
+	rest = kernel_getrandom((unsigned char*) buf + served, buflen - served, flags);
+
+	if(rest < 0)
+	{
+		return served > 0 ? (ssize_t) served : rest;
+	}
+
+	return (ssize_t) served + rest;
+}
+
+int getentropy(void* buffer, size_t length)
+{
+	size_t served;
+	ssize_t rest;
+
+	if(length > RDRAND_PRELOAD_GETENTROPY_MAX)
+	{
+		errno = EIO;
+		return -1;
+	}
+
+	served = preload_serve(buffer, length);
+
+	if(served == length)
+	{
+		return 0;
+	}
+
+	if(real_getentropy != NULL)
+	{
+		return real_getentropy((unsigned char*) buffer + served, length - served);
+	}
+
+	while(served < length)
+	{
+		rest = kernel_getrandom((unsigned char*) buffer + served, length - served, 0);
+
+		if(rest < 0)
+		{
+			if(EINTR == errno)
+			{
+				continue;
+			}
+
+			return -1;
+		}
+
+		served += rest;
+	}
+
+	return 0;
+}
+
+void arc4random_buf(void* buf, size_t nbytes)
+{
+	size_t served;
+	ssize_t rest;
+
+	served = preload_serve(buf, nbytes);
+
+	if(served == nbytes)
+	{
+		return;
+	}
+
+	if(real_arc4random_buf != NULL)
+	{
+		real_arc4random_buf((unsigned char*) buf + served, nbytes - served);
+		return;
+	}
+
+	//arc4random_buf() cannot fail, so keep asking the kernel until it is done
+	while(served < nbytes)
+	{
+		rest = kernel_getrandom((unsigned char*) buf + served, nbytes - served, 0);
+
+		if(rest > 0)
+		{
+			served += rest;
+		}
+	}
+}
+
+int open(const char* pathname, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list args;
+	int fd;
+
+	//O_TMPFILE shares its bits with O_DIRECTORY, so a mode was only passed if all of them are set
+	if((flags & O_CREAT) || O_TMPFILE == (flags & O_TMPFILE))
+	{
+		va_start(args, flags);
+		mode = va_arg(args, mode_t);
+		va_end(args);
+	}
+
+	pthread_once(&preload_once, preload_init);
+
+	fd = real_open(pathname, flags, mode);
+	track_fd(fd, pathname);
+
+	return fd;
+}
+
+int open64(const char* pathname, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list args;
+	int fd;
+
+	if((flags & O_CREAT) || O_TMPFILE == (flags & O_TMPFILE))
+	{
+		va_start(args, flags);
+		mode = va_arg(args, mode_t);
+		va_end(args);
+	}
+
+	pthread_once(&preload_once, preload_init);
+
+	fd = real_open64(pathname, flags, mode);
+	track_fd(fd, pathname);
+
+	return fd;
+}
+
+int openat(int dirfd, const char* pathname, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list args;
+	int fd;
+
+	if((flags & O_CREAT) || O_TMPFILE == (flags & O_TMPFILE))
+	{
+		va_start(args, flags);
+		mode = va_arg(args, mode_t);
+		va_end(args);
+	}
+
+	pthread_once(&preload_once, preload_init);
+
+	fd = real_openat(dirfd, pathname, flags, mode);
+	track_fd(fd, pathname);
+
+	return fd;
+}
+
+ssize_t read(int fd, void* buf, size_t count)
+{
+	size_t served;
+	ssize_t rest;
+
+	pthread_once(&preload_once, preload_init);
+
+	if(!is_tracked_fd(fd) || !is_still_urandom(fd))
+	{
+		return real_read(fd, buf, count);
+	}
+
+	served = preload_serve(buf, count);
+
+	if(served == count)
+	{
+		return (ssize_t) count;
+	}
+
+	rest = real_read(fd, (unsigned char*) buf + served, count - served);
+
+	if(rest < 0)
+	{
+		return served > 0 ? (ssize_t) served : rest;
+	}
+
+	return (ssize_t) served + rest;
+}
+
+int close(int fd)
+{
+	pthread_once(&preload_once, preload_init);
+
+	untrack_fd(fd);
+
+	return real_close(fd);
+}
+
+//dup2() and dup3() silently close "newfd", so it must stop being treated as "/dev/urandom"
+int dup2(int oldfd, int newfd)
+{
+	pthread_once(&preload_once, preload_init);
+
+	untrack_fd(newfd);
+
+	return copy_fd_mark(oldfd, real_dup2(oldfd, newfd));
+}
+
+int dup3(int oldfd, int newfd, int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	untrack_fd(newfd);
+
+	return copy_fd_mark(oldfd, real_dup3(oldfd, newfd, flags));
+}
+
+int dup(int oldfd)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return copy_fd_mark(oldfd, real_dup(oldfd));
+}
+
+//fcntl() hands out a new descriptor for F_DUPFD and F_DUPFD_CLOEXEC. Its third
+//argument is either an int or a pointer, and is passed on as it was given
+int fcntl(int fd, int cmd, ...)
+{
+	va_list args;
+	void* arg;
+	int result;
+
+	va_start(args, cmd);
+	arg = va_arg(args, void*);
+	va_end(args);
+
+	pthread_once(&preload_once, preload_init);
+
+	result = real_fcntl(fd, cmd, arg);
+
+	if(F_DUPFD == cmd || F_DUPFD_CLOEXEC == cmd)
+	{
+		copy_fd_mark(fd, result);
+	}
+
+	return result;
+}
+
+int fcntl64(int fd, int cmd, ...)
+{
+	va_list args;
+	void* arg;
+	int result;
+
+	va_start(args, cmd);
+	arg = va_arg(args, void*);
+	va_end(args);
+
+	pthread_once(&preload_once, preload_init);
+
+	result = (real_fcntl64 != NULL ? real_fcntl64 : real_fcntl)(fd, cmd, arg);
+
+	if(F_DUPFD == cmd || F_DUPFD_CLOEXEC == cmd)
+	{
+		copy_fd_mark(fd, result);
+	}
+
+	return result;
+}
+
+int openat64(int dirfd, const char* pathname, int flags, ...)
+{
+	mode_t mode = 0;
+	va_list args;
+	int fd;
+
+	if((flags & O_CREAT) || O_TMPFILE == (flags & O_TMPFILE))
+	{
+		va_start(args, flags);
+		mode = va_arg(args, mode_t);
+		va_end(args);
+	}
+
+	pthread_once(&preload_once, preload_init);
+
+	fd = real_openat64(dirfd, pathname, flags, mode);
+	track_fd(fd, pathname);
+
+	return fd;
+}
+
+int creat(const char* pathname, mode_t mode)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_creat(pathname, mode));
+}
+
+int creat64(const char* pathname, mode_t mode)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_creat64(pathname, mode));
+}
+
+int socket(int domain, int type, int protocol)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_socket(domain, type, protocol));
+}
+
+int socketpair(int domain, int type, int protocol, int sv[2])
+{
+	int result;
+
+	pthread_once(&preload_once, preload_init);
+
+	result = real_socketpair(domain, type, protocol, sv);
+
+	if(0 == result)
+	{
+		new_fd(sv[0]);
+		new_fd(sv[1]);
+	}
+
+	return result;
+}
+
+int accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_accept(sockfd, addr, addrlen));
+}
+
+int accept4(int sockfd, struct sockaddr* addr, socklen_t* addrlen, int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_accept4(sockfd, addr, addrlen, flags));
+}
+
+int pipe(int pipefd[2])
+{
+	int result;
+
+	pthread_once(&preload_once, preload_init);
+
+	result = real_pipe(pipefd);
+
+	if(0 == result)
+	{
+		new_fd(pipefd[0]);
+		new_fd(pipefd[1]);
+	}
+
+	return result;
+}
+
+int pipe2(int pipefd[2], int flags)
+{
+	int result;
+
+	pthread_once(&preload_once, preload_init);
+
+	result = real_pipe2(pipefd, flags);
+
+	if(0 == result)
+	{
+		new_fd(pipefd[0]);
+		new_fd(pipefd[1]);
+	}
+
+	return result;
+}
+
+int eventfd(unsigned int initval, int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_eventfd(initval, flags));
+}
+
+int memfd_create(const char* name, unsigned int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_memfd_create(name, flags));
+}
+
+//The signal mask is passed through untouched, so its type does not matter here
+int signalfd(int fd, const void* mask, int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_signalfd(fd, mask, flags));
+}
+
+int timerfd_create(int clockid, int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_timerfd_create(clockid, flags));
+}
+
+int epoll_create(int size)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_epoll_create(size));
+}
+
+int epoll_create1(int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_epoll_create1(flags));
+}
+
+int inotify_init(void)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_inotify_init());
+}
+
+int inotify_init1(int flags)
+{
+	pthread_once(&preload_once, preload_init);
+
+	return new_fd(real_inotify_init1(flags));
+}
+
+//Once a descriptor belongs to a FILE stream, stdio reads and closes it without
+//calling read() or close(), so it is forgotten right away
+FILE* fdopen(int fd, const char* mode)
+{
+	pthread_once(&preload_once, preload_init);
+
+	untrack_fd(fd);
+
+	return real_fdopen(fd, mode);
+}
+
+int close_range(unsigned int first, unsigned int last, int flags)
+{
+	unsigned int fd;
+
+	pthread_once(&preload_once, preload_init);
+
+	//with CLOSE_RANGE_CLOEXEC the descriptors stay open until exec, which starts us over anyway
+	if(!(flags & CLOSE_RANGE_CLOEXEC))
+	{
+		for( fd = first; fd <= last && fd < RDRAND_PRELOAD_MAX_FD; fd++ )
+		{
+			untrack_fd((int) fd);
+		}
+	}
+
+	if(real_close_range != NULL)
+	{
+		return real_close_range(first, last, flags);
+	}
+
+	return syscall(SYS_close_range, first, last, flags);
+}
+
+void closefrom(int lowfd)
+{
+	int fd;
+
+	pthread_once(&preload_once, preload_init);
+
+	for( fd = lowfd < 0 ? 0 : lowfd; fd < RDRAND_PRELOAD_MAX_FD; fd++ )
+	{
+		untrack_fd(fd);
+	}
+
+	if(real_closefrom != NULL)
+	{
+		real_closefrom(lowfd);
+		return;
+	}
+
+	syscall(SYS_close_range, (unsigned int) lowfd, ~0U, 0);
+}
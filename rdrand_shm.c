@@ -0,0 +1,602 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.1
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "rdrand_shm.h"
+
+
+
+//Written into the ring's header so that consumers never attach to something else
+#define RDRAND_SHM_MAGIC 0x52445348
+#define RDRAND_SHM_VERSION 4
+
+//Largest number of slots a ring may have
+#define RDRAND_SHM_MAX_SLOTS (1 << 24)
+
+//A claimed slot whose consumer never recorded its pid is taken back after this many nanoseconds.
+//That consumer may only be slow rather than dead, which is safe because it hands the slot back
+//with a compare-and-swap and throws its copy away if the slot was taken from it
+#define RDRAND_SHM_STUCK_NS 1000000000LL
+
+
+//Every slot carries a sequence number, which works like this for the slot at ring position "pos":
+//	seq == pos				the slot is empty and the producer may fill it
+//	seq == pos + 1			the slot is full and a consumer may claim it
+//	seq == pos + slots		the consumer is done with it, and it is empty again for the next lap
+//"claim" holds the low 32 bits of the position the slot was claimed at in its top half, and the
+//pid of the consumer copying it out in its bottom half. The producer uses it to take the slot
+//back if that consumer dies before it is done. The position keeps a pid left over from an
+//earlier lap from being mistaken for the current claimer
+struct rdrand_shm_slot
+{
+	_Atomic unsigned long long seq;
+	_Atomic unsigned long long claim;
+	unsigned char data[RDRAND_SHM_SLOT_BYTES];
+} __attribute__((aligned(64)));
+
+//The layout of the shared memory. The producer and consumer positions are kept
+//on separate cache lines so that claiming a slot does not slow down the producer
+struct rdrand_shm_header
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int slots;
+	unsigned int slot_bytes;
+
+	//pid of the producer filling the ring, or 0 once it has shut down
+	_Atomic int producer_pid;
+
+	_Atomic unsigned long long produce_pos __attribute__((aligned(64)));
+	_Atomic unsigned long long consume_pos __attribute__((aligned(64)));
+
+	//only written by the producer, and read by anybody through rdrand_shm_get_stats()
+	_Atomic unsigned long long reclaimed_slots __attribute__((aligned(64)));
+	_Atomic unsigned long long stalls;
+
+	struct rdrand_shm_slot slot[] __attribute__((aligned(64)));
+};
+
+//The process-local handle for a mapped ring
+struct rdrand_shm
+{
+	struct rdrand_shm_header* header;
+	size_t mapped_bytes;
+	unsigned long long mask;
+	int is_producer;
+	char* name;
+
+	//the producer's record of the claimed slot it is currently waiting on
+	unsigned long long stuck_pos;
+	long long stuck_since_ns;
+};
+
+
+//getpid() is a system call, so consumers keep their pid here. It is refreshed in forked children
+static atomic_int cached_pid;
+static pthread_once_t pid_once = PTHREAD_ONCE_INIT;
+
+static void refresh_cached_pid(void)
+{
+	atomic_store_explicit(&cached_pid, (int) getpid(), memory_order_relaxed);
+}
+
+static void init_cached_pid(void)
+{
+	refresh_cached_pid();
+	pthread_atfork(NULL, NULL, refresh_cached_pid);
+}
+
+static long long now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+
+//Creates the process-local handle for a ring that has just been mapped
+static rdrand_shm* new_handle(struct rdrand_shm_header* header, size_t mapped_bytes, const char* name, int is_producer)
+{
+	rdrand_shm* ring = malloc(sizeof(rdrand_shm));
+
+	if(NULL == ring)
+	{
+		return NULL;
+	}
+
+	ring->name = malloc(strlen(name) + 1);
+
+	if(NULL == ring->name)
+	{
+		free(ring);
+		return NULL;
+	}
+
+	strcpy(ring->name, name);
+	ring->header = header;
+	ring->mapped_bytes = mapped_bytes;
+	ring->mask = header->slots - 1;
+	ring->is_producer = is_producer;
+	ring->stuck_pos = ~0ULL;
+	ring->stuck_since_ns = 0;
+
+	return ring;
+}
+
+//Returns 1 if the ring called "name" exists and its producer is still running, 0 otherwise
+static int has_live_producer(const char* name)
+{
+	struct rdrand_shm_header* header;
+	struct stat info;
+	int fd;
+	int pid = 0;
+
+	fd = shm_open(name, O_RDONLY, 0);
+
+	if(fd < 0)
+	{
+		return 0;
+	}
+
+	if(0 == fstat(fd, &info) && (size_t) info.st_size >= sizeof(struct rdrand_shm_header))
+	{
+		header = mmap(NULL, sizeof(struct rdrand_shm_header), PROT_READ, MAP_SHARED, fd, 0);
+
+		if(MAP_FAILED != header)
+		{
+			//rings made by other versions of this library may keep the pid somewhere else
+			if(RDRAND_SHM_MAGIC == header->magic && RDRAND_SHM_VERSION == header->version)
+			{
+				pid = atomic_load(&header->producer_pid);
+			}
+
+			munmap(header, sizeof(struct rdrand_shm_header));
+		}
+	}
+
+	close(fd);
+
+	//EPERM means the process exists but belongs to somebody else
+	return 0 != pid && (0 == kill(pid, 0) || EPERM == errno);
+}
+
+//Creates the shared memory ring called "name" (for example "/rdrand") with "slots" slots.
+//"slots" is rounded up to a power of 2. A stale ring with the same name is replaced, but a
+//ring whose producer is still running is left alone.
+//Returns NULL, with errno set to EEXIST in that case, if the ring could not be created
+rdrand_shm* rdrand_shm_create(const char* name, int slots)
+{
+	struct rdrand_shm_header* header;
+	rdrand_shm* ring;
+	size_t mapped_bytes;
+	unsigned int rounded_slots = 1;
+	unsigned int i;
+	int fd;
+
+	if(slots <= 0)
+	{
+		slots = RDRAND_SHM_DEFAULT_SLOTS;
+	}
+
+	if(slots > RDRAND_SHM_MAX_SLOTS)
+	{
+		return NULL;
+	}
+
+	//the slot index is taken from the ring position with a mask, so the slot count must be a power of 2
+	while(rounded_slots < (unsigned int) slots)
+	{
+		rounded_slots <<= 1;
+	}
+
+	mapped_bytes = sizeof(struct rdrand_shm_header) + rounded_slots * sizeof(struct rdrand_shm_slot);
+
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+	if(fd < 0 && EEXIST == errno)
+	{
+		//replacing a live ring would strand every consumer attached to it
+		if(has_live_producer(name))
+		{
+			errno = EEXIST;
+			return NULL;
+		}
+
+		//the old producer is gone. Consumers still attached to its ring keep their
+		//mapping, and fall back to rdrand_get_bytes() once it runs empty
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	}
+
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	if(0 != ftruncate(fd, mapped_bytes))
+	{
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	header = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(MAP_FAILED == header)
+	{
+		shm_unlink(name);
+		return NULL;
+	}
+
+	header->slots = rounded_slots;
+	header->slot_bytes = RDRAND_SHM_SLOT_BYTES;
+	atomic_init(&header->produce_pos, 0);
+	atomic_init(&header->consume_pos, 0);
+	atomic_init(&header->reclaimed_slots, 0);
+	atomic_init(&header->stalls, 0);
+
+	for(i = 0; i < rounded_slots; i++)
+	{
+		atomic_init(&header->slot[i].seq, i);
+		atomic_init(&header->slot[i].claim, 0);
+	}
+
+	atomic_init(&header->producer_pid, (int) getpid());
+	header->version = RDRAND_SHM_VERSION;
+
+	//the magic number is written last, so a consumer that sees it also sees a fully set up ring
+	atomic_thread_fence(memory_order_release);
+	header->magic = RDRAND_SHM_MAGIC;
+
+	ring = new_handle(header, mapped_bytes, name, 1);
+
+	if(NULL == ring)
+	{
+		munmap(header, mapped_bytes);
+		shm_unlink(name);
+	}
+
+	return ring;
+}
+
+//Called by the producer when the slot at ring position "pos" was claimed on the last lap but
+//never handed back. If the consumer that claimed it is dead, or never got as far as recording
+//its pid within RDRAND_SHM_STUCK_NS, the slot is made empty again.
+//Returns 1 if the slot is empty now, 0 if the producer has to keep waiting for it
+static int reclaim_slot(rdrand_shm* ring, struct rdrand_shm_slot* slot, unsigned long long pos)
+{
+	unsigned long long claimed_pos = pos - (ring->mask + 1);
+	unsigned long long claimed_seq = claimed_pos + 1;
+	unsigned long long claim;
+	long long now = now_ns();
+	int pid = 0;
+	int abandoned;
+
+	if(ring->stuck_pos != pos)
+	{
+		ring->stuck_pos = pos;
+		ring->stuck_since_ns = now;
+	}
+
+	claim = atomic_load_explicit(&slot->claim, memory_order_relaxed);
+
+	if((claim >> 32) == (claimed_pos & 0xFFFFFFFFULL))
+	{
+		pid = (int) (claim & 0xFFFFFFFFULL);
+	}
+
+	if(0 != pid)
+	{
+		abandoned = (0 != kill(pid, 0) && ESRCH == errno);
+	}
+
+	else
+	{
+		abandoned = (now - ring->stuck_since_ns > RDRAND_SHM_STUCK_NS);
+	}
+
+	if(!abandoned)
+	{
+		return RDRAND_FAIL;
+	}
+
+	//if the consumer hands the slot back first it stores this same value, so losing the race is fine.
+	//If we win, the consumer's own compare-and-swap fails and it throws its copy away
+	if(atomic_compare_exchange_strong_explicit(&slot->seq, &claimed_seq, pos, memory_order_acquire, memory_order_relaxed))
+	{
+		atomic_fetch_add_explicit(&ring->header->reclaimed_slots, 1, memory_order_relaxed);
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Fills every empty slot in the ring with RDRAND output and stores the number of slots
+//that were filled in "slotsFilled" (which may be NULL). Only one process may call this
+//function for a given ring. Returns 1 if successful, 0 if RDRAND failed
+int rdrand_shm_produce(rdrand_shm* ring, int* slotsFilled)
+{
+	struct rdrand_shm_header* header = ring->header;
+	struct rdrand_shm_slot* slot;
+	unsigned long long pos;
+	unsigned long long seq;
+	int filled = 0;
+	int success = RDRAND_SUCCESS;
+
+	//there is only one producer, so nobody else ever moves "produce_pos"
+	pos = atomic_load_explicit(&header->produce_pos, memory_order_relaxed);
+
+	for(;;)
+	{
+		slot = &header->slot[pos & ring->mask];
+		seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+		if(seq != pos)
+		{
+			//the slot is still full from the last lap. If nobody has claimed it, the ring is just full.
+			//If it was claimed but never handed back, its consumer may have died while copying it
+			if(seq == pos - ring->mask && atomic_load_explicit(&header->consume_pos, memory_order_relaxed) > pos - (ring->mask + 1))
+			{
+				if(RDRAND_SUCCESS == reclaim_slot(ring, slot, pos))
+				{
+					continue;
+				}
+
+				atomic_fetch_add_explicit(&header->stalls, 1, memory_order_relaxed);
+			}
+
+			break;
+		}
+
+		if(RDRAND_FAIL == rdrand_get_bytes(slot->data, RDRAND_SHM_SLOT_BYTES))
+		{
+			success = RDRAND_FAIL;
+			break;
+		}
+
+		//publishing the slot makes its data visible to the consumer that claims it
+		atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+		pos++;
+		filled++;
+	}
+
+	atomic_store_explicit(&header->produce_pos, pos, memory_order_relaxed);
+
+	if(slotsFilled != NULL)
+	{
+		*slotsFilled = filled;
+	}
+
+	return success;
+}
+
+//Attaches to the shared memory ring called "name".
+//Returns NULL if no producer has created the ring
+rdrand_shm* rdrand_shm_attach(const char* name)
+{
+	struct rdrand_shm_header* header;
+	struct stat info;
+	rdrand_shm* ring;
+	size_t mapped_bytes;
+	int fd;
+
+	fd = shm_open(name, O_RDWR, 0);
+
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	if(0 != fstat(fd, &info) || (size_t) info.st_size < sizeof(struct rdrand_shm_header))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	mapped_bytes = info.st_size;
+	header = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(MAP_FAILED == header)
+	{
+		return NULL;
+	}
+
+	//refuse rings that are still being set up, or that were made by some other version of this library
+	if(RDRAND_SHM_MAGIC != header->magic)
+	{
+		munmap(header, mapped_bytes);
+		return NULL;
+	}
+
+	atomic_thread_fence(memory_order_acquire);
+
+	if(RDRAND_SHM_VERSION != header->version
+		|| RDRAND_SHM_SLOT_BYTES != header->slot_bytes
+		|| 0 == header->slots
+		|| 0 != (header->slots & (header->slots - 1))
+		|| mapped_bytes < sizeof(struct rdrand_shm_header) + header->slots * sizeof(struct rdrand_shm_slot))
+	{
+		munmap(header, mapped_bytes);
+		return NULL;
+	}
+
+	pthread_once(&pid_once, init_cached_pid);
+
+	ring = new_handle(header, mapped_bytes, name, 0);
+
+	if(NULL == ring)
+	{
+		munmap(header, mapped_bytes);
+	}
+
+	return ring;
+}
+
+//Claims the next full slot and copies up to "bytes" of it into "dest". The slot is
+//handed back to the producer as soon as the copy is done.
+//Returns 1 if a slot was claimed, 0 if the ring was empty
+static int claim_slot(rdrand_shm* ring, unsigned char* dest, int bytes)
+{
+	struct rdrand_shm_header* header = ring->header;
+	struct rdrand_shm_slot* slot;
+	unsigned long long pos;
+	unsigned long long seq;
+	unsigned long long claim;
+	long long difference;
+
+	for(;;)
+	{
+		pos = atomic_load_explicit(&header->consume_pos, memory_order_relaxed);
+
+		for(;;)
+		{
+			slot = &header->slot[pos & ring->mask];
+			seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+			difference = (long long) (seq - (pos + 1));
+
+			if(0 == difference)
+			{
+				//the slot is full. Whoever moves "consume_pos" past it owns it
+				if(atomic_compare_exchange_weak_explicit(&header->consume_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+				{
+					break;
+				}
+			}
+
+			else if(difference < 0)
+			{
+				//the producer has not filled this slot yet, so the ring is empty
+				return RDRAND_FAIL;
+			}
+
+			else
+			{
+				//another consumer claimed this slot first
+				pos = atomic_load_explicit(&header->consume_pos, memory_order_relaxed);
+			}
+		}
+
+		//lets the producer take the slot back if this process dies before handing it back
+		claim = ((pos & 0xFFFFFFFFULL) << 32) | (unsigned int) atomic_load_explicit(&cached_pid, memory_order_relaxed);
+		atomic_store_explicit(&slot->claim, claim, memory_order_relaxed);
+
+		memcpy(dest, slot->data, bytes);
+
+		//give the slot back to the producer for its next lap around the ring. If the producer took
+		//it back while we were stalled, it may already hold new bytes meant for somebody else, so
+		//what we copied is thrown away and another slot is claimed
+		seq = pos + 1;
+
+		if(atomic_compare_exchange_strong_explicit(&slot->seq, &seq, pos + ring->mask + 1, memory_order_release, memory_order_relaxed))
+		{
+			return RDRAND_SUCCESS;
+		}
+	}
+}
+
+//Fills "dest" with "bytes" random bytes taken from the ring. If "ring" is NULL, or the
+//ring runs empty, the rest of the buffer is filled by calling rdrand_get_bytes() directly.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_shm_get_bytes(rdrand_shm* ring, void* dest, int bytes)
+{
+	unsigned char* ptr_8bit = dest;
+	int chunk;
+
+	if(ring != NULL)
+	{
+		while(bytes > 0)
+		{
+			chunk = bytes < RDRAND_SHM_SLOT_BYTES ? bytes : RDRAND_SHM_SLOT_BYTES;
+
+			if(RDRAND_FAIL == claim_slot(ring, ptr_8bit, chunk))
+			{
+				break;
+			}
+
+			ptr_8bit += chunk;
+			bytes -= chunk;
+		}
+	}
+
+	//no producer, or the producer is not keeping up
+	if(bytes > 0)
+	{
+		return rdrand_get_bytes(ptr_8bit, bytes);
+	}
+
+	return RDRAND_SUCCESS;
+}
+
+//Stores how many abandoned slots the producer has taken back, and how many times it had to stop
+//filling because a claimed slot had not been handed back yet
+void rdrand_shm_get_stats(rdrand_shm* ring, unsigned long long* reclaimedSlots, unsigned long long* stalls)
+{
+	*reclaimedSlots = atomic_load_explicit(&ring->header->reclaimed_slots, memory_order_relaxed);
+	*stalls = atomic_load_explicit(&ring->header->stalls, memory_order_relaxed);
+}
+
+//Unmaps the ring and frees "ring". When called by the producer, the ring's name is
+//also removed, and consumers that are still attached fall back to rdrand_get_bytes()
+//once the ring runs empty
+void rdrand_shm_close(rdrand_shm* ring)
+{
+	if(NULL == ring)
+	{
+		return;
+	}
+
+	if(ring->is_producer)
+	{
+		atomic_store(&ring->header->producer_pid, 0);
+		shm_unlink(ring->name);
+	}
+
+	munmap(ring->header, ring->mapped_bytes);
+	free(ring->name);
+	free(ring);
+}
@@ -0,0 +1,103 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.1
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef RDRAND_SHM_H
+#define RDRAND_SHM_H
+
+#include "rdrandlib.h"
+
+
+//These functions let one producer process keep a shared memory ring full of
+//RDRAND output, so that many consumer processes on the same machine can take
+//random bytes from it instead of all hitting the DRNG at once.
+//
+//The ring is split into slots. A consumer claims whole slots with a single
+//compare-and-swap, and a slot is only refilled by the producer after its
+//consumer has finished copying it out, so no byte is ever handed to two
+//callers. Bytes left over in a partly used slot are thrown away. If a consumer
+//dies while copying a slot out, the producer takes the slot back. A consumer
+//that was only stalled notices this when it hands the slot back, throws its
+//copy away and claims another slot.
+//
+//The ring is created with permissions 0600, so only processes running as the
+//same user can attach to it. Keep in mind that any process that can attach
+//can also read slots that will later be handed to somebody else.
+
+
+//Number of random bytes in each slot of the ring
+#define RDRAND_SHM_SLOT_BYTES 64
+
+//Number of slots used when the producer asks for 0
+#define RDRAND_SHM_DEFAULT_SLOTS 4096
+
+typedef struct rdrand_shm rdrand_shm;
+
+
+/*PRODUCER FUNCTIONS*/
+
+//Creates the shared memory ring called "name" (for example "/rdrand") with "slots" slots.
+//"slots" is rounded up to a power of 2. A stale ring with the same name is replaced, but a
+//ring whose producer is still running is left alone.
+//Returns NULL, with errno set to EEXIST in that case, if the ring could not be created
+rdrand_shm* rdrand_shm_create(const char* name, int slots);
+
+//Fills every empty slot in the ring with RDRAND output and stores the number of slots
+//that were filled in "slotsFilled" (which may be NULL). Only one process may call this
+//function for a given ring. Returns 1 if successful, 0 if RDRAND failed
+int rdrand_shm_produce(rdrand_shm* ring, int* slotsFilled);
+
+
+/*CONSUMER FUNCTIONS*/
+
+//Attaches to the shared memory ring called "name".
+//Returns NULL if no producer has created the ring
+rdrand_shm* rdrand_shm_attach(const char* name);
+
+//Fills "dest" with "bytes" random bytes taken from the ring. If "ring" is NULL, or the
+//ring runs empty, the rest of the buffer is filled by calling rdrand_get_bytes() directly.
+//Returns 1 if successful, 0 if unsuccessful
+int rdrand_shm_get_bytes(rdrand_shm* ring, void* dest, int bytes);
+
+
+//Stores how many abandoned slots the producer has taken back, and how many times it had to stop
+//filling because a claimed slot had not been handed back yet
+void rdrand_shm_get_stats(rdrand_shm* ring, unsigned long long* reclaimedSlots, unsigned long long* stalls);
+
+//Unmaps the ring and frees "ring". When called by the producer, the ring's name is
+//also removed, and consumers that are still attached fall back to rdrand_get_bytes()
+//once the ring runs empty
+void rdrand_shm_close(rdrand_shm* ring);
+
+#endif
@@ -0,0 +1,145 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.2
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+//This program is the producer for the shared memory entropy ring. It keeps the
+//ring full of RDRAND output so that consumer processes can call
+//rdrand_shm_get_bytes() instead of running RDRAND themselves.
+//
+//Usage: rdrand_shm_producer [name] [slots]
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "rdrand_shm.h"
+
+
+//Name of the ring when none is given on the command line
+#define DEFAULT_RING_NAME "/rdrand"
+
+//How long to sleep when the ring is already full, in nanoseconds
+#define FULL_RING_SLEEP_NS 100000
+
+static volatile sig_atomic_t keep_running = 1;
+
+static void stop_producer(int signal_number)
+{
+	(void) signal_number;
+
+	keep_running = 0;
+}
+
+
+int main(int argc, char** argv)
+{
+	const char* name = DEFAULT_RING_NAME;
+	int slots = RDRAND_SHM_DEFAULT_SLOTS;
+	int filled;
+	unsigned long long reclaimed;
+	unsigned long long stalls;
+	unsigned long long reported_reclaimed = 0;
+	unsigned long long reported_stalls = 0;
+	time_t last_report = 0;
+	rdrand_shm* ring;
+	struct timespec pause = { 0, FULL_RING_SLEEP_NS };
+
+	if(argc > 1)
+	{
+		name = argv[1];
+	}
+
+	if(argc > 2)
+	{
+		slots = atoi(argv[2]);
+	}
+
+	if(RDRAND_NOT_SUPPORTED == Check_RDRAND_Support())
+	{
+		printf("RDRAND instruction IS NOT supported on this processor\n");
+		return 1;
+	}
+
+	ring = rdrand_shm_create(name, slots);
+
+	if(NULL == ring)
+	{
+		if(EEXIST == errno)
+		{
+			printf("Another producer is already running for the shared memory ring \"%s\"\n", name);
+		}
+
+		else
+		{
+			printf("Could not create the shared memory ring \"%s\"\n", name);
+		}
+
+		return 1;
+	}
+
+	//remove the ring's name on the way out so consumers stop waiting on it
+	signal(SIGINT, stop_producer);
+	signal(SIGTERM, stop_producer);
+
+	while(keep_running)
+	{
+		if(RDRAND_FAIL == rdrand_shm_produce(ring, &filled))
+		{
+			printf("RDRAND failed to fill the shared memory ring\n");
+		}
+
+		if(0 == filled)
+		{
+			nanosleep(&pause, NULL);
+		}
+
+		//report consumers that died holding a slot, at most once a second
+		rdrand_shm_get_stats(ring, &reclaimed, &stalls);
+
+		if((reclaimed != reported_reclaimed || stalls != reported_stalls) && time(NULL) != last_report)
+		{
+			printf("Slots taken back from dead consumers: %llu, times stopped on an unreturned slot: %llu\n", reclaimed, stalls);
+			fflush(stdout);
+
+			reported_reclaimed = reclaimed;
+			reported_stalls = stalls;
+			last_report = time(NULL);
+		}
+	}
+
+	rdrand_shm_close(ring);
+
+	return 0;
+}
@@ -0,0 +1,654 @@
+/*
+
+Copyright (c) 2014 Matthew Mummert
+
+Version: 0.2
+
+Developer Contact Info:
+matthewmummert5 <?/!_a_t_|!?> gmail <D _ 0 _ t> com
+
+
+License Agreement:
+
+This software may be used and distributed in accordance with the MIT open source license.
+Use of this software constitutes and agreement to abide by the terms below.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+//This program runs a set of statistical tests on random data as fast as it can be
+//generated, without ever writing the data to disk. It is meant for qualifying a new
+//CPU or microcode release in minutes rather than hours.
+//
+//Every thread fills its own buffer from the chosen backend and keeps running totals
+//for these tests:
+//	byte		chi-square test of how often each of the 256 byte values appears
+//	bit			frequency (monobit) test of the number of 1 bits
+//	runs		runs test on the number of changes between neighbouring bits
+//	serial		serial correlation between neighbouring bytes
+//	gap			chi-square test of the gaps between bytes below 64
+//	compress	best possible compression ratio for a byte-by-byte compressor, worked out
+//				from the byte counts (1.000000 means the data cannot be compressed)
+//
+//After every report interval the totals from all threads are merged and a line of
+//p-values is printed. A p-value below 0.0001 is marked with a '*'.
+//
+//Usage: rdrand_stattest [-b rdrand|getrandom|xoshiro] [-t threads] [-s total MB] [-r report MB] [-c cache file]
+
+#include <emmintrin.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <time.h>
+#include <unistd.h>
+#include "rdrand_bulk.h"
+
+
+
+//Number of bytes each thread fills and tests at a time
+#define CHUNK_BYTES (1024 * 1024)
+
+//Largest number of worker threads
+#define MAX_THREADS 256
+
+//Bytes below this value count as a "hit" for the gap test, which makes the hit probability 1/4.
+//It must be a power of 2 so that hits can be found by masking the top bits of each byte
+#define GAP_HIT_LIMIT 64
+
+//Gaps of this length or longer are counted together in the last bin of the gap test
+#define GAP_BINS 16
+
+//p-values below this are marked as suspicious
+#define SUSPICIOUS_P_VALUE 0.0001
+
+//The different sources of random data that can be tested
+#define BACKEND_RDRAND 0
+#define BACKEND_GETRANDOM 1
+#define BACKEND_XOSHIRO 2
+
+
+//Running totals for every test. Each thread keeps its own, and they are added together for every report
+struct test_totals
+{
+	unsigned long long byte_count[256];
+	unsigned long long bytes;
+
+	unsigned long long ones;
+	unsigned long long bit_changes;
+	unsigned long long bit_pairs;
+
+	unsigned long long byte_sum;
+	unsigned long long byte_square_sum;
+	unsigned long long neighbour_product_sum;
+	unsigned long long byte_pairs;
+
+	unsigned long long gap_count[GAP_BINS + 1];
+};
+
+//Everything one worker thread needs
+struct worker
+{
+	pthread_t thread;
+	int backend;
+	int chunks; //number of chunks to test this round
+	int failed;
+	unsigned char* buffer;
+	unsigned long long xoshiro[4];
+	struct test_totals totals;
+};
+
+
+//Software generator used to compare against RDRAND (xoshiro256**)
+static unsigned long long xoshiro_next(unsigned long long* state)
+{
+	unsigned long long result = state[1] * 5;
+	unsigned long long t = state[1] << 17;
+
+	result = ((result << 7) | (result >> 57)) * 9;
+
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = (state[3] << 45) | (state[3] >> 19);
+
+	return result;
+}
+
+//Fills "dest" from the chosen backend. Returns 1 if successful, 0 if unsuccessful
+static int fill_from_backend(struct worker* self, unsigned char* dest, size_t bytes)
+{
+	unsigned long long word;
+	ssize_t got;
+	size_t i;
+
+	switch(self->backend)
+	{
+		case BACKEND_GETRANDOM:
+			while(bytes > 0)
+			{
+				got = getrandom(dest, bytes, 0);
+
+				if(got < 0)
+				{
+					return RDRAND_FAIL;
+				}
+
+				dest += got;
+				bytes -= got;
+			}
+
+			return RDRAND_SUCCESS;
+
+		case BACKEND_XOSHIRO:
+			for( i = 0; i < bytes; i += 8 )
+			{
+				word = xoshiro_next(self->xoshiro);
+				memcpy(dest + i, &word, 8);
+			}
+
+			return RDRAND_SUCCESS;
+
+		default:
+			return rdrand_bulk_fill(dest, bytes);
+	}
+}
+
+//Adds the results for one chunk to "totals". The loops are kept simple so the
+//compiler can vectorize them
+static void test_chunk(struct test_totals* totals, const unsigned char* data, size_t bytes)
+{
+	unsigned long long partial_count[4][256];
+	unsigned long long word;
+	unsigned long long previous_top = 0;
+	unsigned long long changes = 0;
+	unsigned long long ones = 0;
+	unsigned long long sum = 0;
+	unsigned long long square_sum = 0;
+	unsigned long long product_sum = 0;
+	unsigned long long hits;
+	size_t next_gap_start = 0;
+	size_t position;
+	size_t gap;
+	__m128i lanes;
+	__m128i top_bits = _mm_set1_epi8((char) (0x100 - GAP_HIT_LIMIT));
+	__m128i zero = _mm_setzero_si128();
+	size_t i;
+	size_t j;
+
+	//counting into four tables at once avoids stalling on repeated byte values
+	memset(partial_count, 0, sizeof(partial_count));
+
+	for( i = 0; i < bytes; i += 4 )
+	{
+		partial_count[0][data[i]]++;
+		partial_count[1][data[i + 1]]++;
+		partial_count[2][data[i + 2]]++;
+		partial_count[3][data[i + 3]]++;
+	}
+
+	for( i = 0; i < 256; i++ )
+	{
+		totals->byte_count[i] += partial_count[0][i] + partial_count[1][i] + partial_count[2][i] + partial_count[3][i];
+	}
+
+	//bits are read least significant first. A change between two neighbouring bits is a 1 in
+	//word ^ (word >> 1), and the change across a word boundary is checked with the previous top bit
+	for( i = 0; i < bytes; i += 8 )
+	{
+		memcpy(&word, data + i, 8);
+
+		ones += __builtin_popcountll(word);
+		changes += __builtin_popcountll((word ^ (word >> 1)) & 0x7FFFFFFFFFFFFFFFULL);
+
+		if(i > 0)
+		{
+			changes += previous_top ^ (word & 1);
+		}
+
+		previous_top = word >> 63;
+	}
+
+	for( i = 0; i < bytes; i++ )
+	{
+		sum += data[i];
+		square_sum += data[i] * data[i];
+	}
+
+	for( i = 0; i + 1 < bytes; i++ )
+	{
+		product_sum += data[i] * data[i + 1];
+	}
+
+	//gaps that run past the end of the chunk are dropped. The hits in each block of 64 bytes
+	//are gathered into a bit mask with SSE2 first and then walked one set bit at a time, which avoids
+	//a hard to predict branch on every byte
+	for( i = 0; i < bytes; i += 64 )
+	{
+		hits = 0;
+
+		if(bytes - i >= 64)
+		{
+			//a byte is below 64 exactly when its top two bits are clear
+			for( j = 0; j < 64; j += 16 )
+			{
+				lanes = _mm_loadu_si128((const __m128i*) (data + i + j));
+				lanes = _mm_cmpeq_epi8(_mm_and_si128(lanes, top_bits), zero);
+				hits |= (unsigned long long) (unsigned int) _mm_movemask_epi8(lanes) << j;
+			}
+		}
+
+		else
+		{
+			for( j = 0; i + j < bytes; j++ )
+			{
+				hits |= (unsigned long long) (data[i + j] < GAP_HIT_LIMIT) << j;
+			}
+		}
+
+		while(hits)
+		{
+			position = i + __builtin_ctzll(hits);
+			gap = position - next_gap_start;
+			totals->gap_count[gap < GAP_BINS ? gap : GAP_BINS]++;
+			next_gap_start = position + 1;
+			hits &= hits - 1;
+		}
+	}
+
+	totals->bytes += bytes;
+	totals->ones += ones;
+	totals->bit_changes += changes;
+	totals->bit_pairs += bytes * 8 - 1;
+	totals->byte_sum += sum;
+	totals->byte_square_sum += square_sum;
+	totals->neighbour_product_sum += product_sum;
+	totals->byte_pairs += bytes - 1;
+}
+
+static void* worker_main(void* arg)
+{
+	struct worker* self = arg;
+	int i;
+
+	for( i = 0; i < self->chunks; i++ )
+	{
+		if(RDRAND_FAIL == fill_from_backend(self, self->buffer, CHUNK_BYTES))
+		{
+			self->failed = 1;
+			break;
+		}
+
+		test_chunk(&self->totals, self->buffer, CHUNK_BYTES);
+	}
+
+	return NULL;
+}
+
+static void add_totals(struct test_totals* sum, const struct test_totals* part)
+{
+	int i;
+
+	for( i = 0; i < 256; i++ )
+	{
+		sum->byte_count[i] += part->byte_count[i];
+	}
+
+	for( i = 0; i <= GAP_BINS; i++ )
+	{
+		sum->gap_count[i] += part->gap_count[i];
+	}
+
+	sum->bytes += part->bytes;
+	sum->ones += part->ones;
+	sum->bit_changes += part->bit_changes;
+	sum->bit_pairs += part->bit_pairs;
+	sum->byte_sum += part->byte_sum;
+	sum->byte_square_sum += part->byte_square_sum;
+	sum->neighbour_product_sum += part->neighbour_product_sum;
+	sum->byte_pairs += part->byte_pairs;
+}
+
+
+
+
+//Regularized upper incomplete gamma function Q(a, x), which gives the p-value of a
+//chi-square statistic "x * 2" with "a * 2" degrees of freedom
+static double upper_incomplete_gamma(double a, double x)
+{
+	double sum;
+	double term;
+	double b, c, d, h, an, delta;
+	int i;
+
+	if(x <= 0.0)
+	{
+		return 1.0;
+	}
+
+	//below a + 1 the series for the lower function converges quickly
+	if(x < a + 1.0)
+	{
+		sum = term = 1.0 / a;
+
+		for( i = 1; i < 1000 && fabs(term) > fabs(sum) * 1e-15; i++ )
+		{
+			term *= x / (a + i);
+			sum += term;
+		}
+
+		return 1.0 - sum * exp(-x + a * log(x) - lgamma(a));
+	}
+
+	//above it, use the continued fraction for the upper function (modified Lentz's method)
+	b = x + 1.0 - a;
+	c = 1.0 / 1e-300;
+	d = 1.0 / b;
+	h = d;
+
+	for( i = 1; i < 1000; i++ )
+	{
+		an = -i * (i - a);
+		b += 2.0;
+		d = an * d + b;
+		d = fabs(d) < 1e-300 ? 1e-300 : d;
+		c = b + an / c;
+		c = fabs(c) < 1e-300 ? 1e-300 : c;
+		d = 1.0 / d;
+		delta = d * c;
+		h *= delta;
+
+		if(fabs(delta - 1.0) < 1e-15)
+		{
+			break;
+		}
+	}
+
+	return exp(-x + a * log(x) - lgamma(a)) * h;
+}
+
+static double chi_square_p_value(double statistic, int degreesOfFreedom)
+{
+	return upper_incomplete_gamma(degreesOfFreedom / 2.0, statistic / 2.0);
+}
+
+//Works out every p-value from the merged totals and prints them on one line
+static void print_report(const struct test_totals* totals, double seconds)
+{
+	double p[5];
+	double expected;
+	double statistic;
+	double bits = (double) totals->bytes * 8.0;
+	double proportion;
+	double mean;
+	double variance;
+	double correlation;
+	double entropy = 0.0;
+	double probability;
+	double miss;
+	int i;
+
+	//byte frequency
+	expected = totals->bytes / 256.0;
+	statistic = 0.0;
+
+	for( i = 0; i < 256; i++ )
+	{
+		statistic += (totals->byte_count[i] - expected) * (totals->byte_count[i] - expected) / expected;
+	}
+
+	p[0] = chi_square_p_value(statistic, 255);
+
+	//bit frequency
+	p[1] = erfc(fabs(2.0 * totals->ones - bits) / sqrt(2.0 * bits));
+
+	//runs, which is only meaningful if the bit frequency is close to 1/2
+	proportion = totals->ones / bits;
+
+	if(fabs(proportion - 0.5) >= 2.0 / sqrt(bits))
+	{
+		p[2] = 0.0;
+	}
+
+	else
+	{
+		p[2] = erfc(fabs(totals->bit_changes - 2.0 * totals->bit_pairs * proportion * (1.0 - proportion))
+			/ (2.0 * sqrt(2.0 * totals->bit_pairs) * proportion * (1.0 - proportion)));
+	}
+
+	//serial correlation, which is close to normal with variance 1 / n for random data
+	mean = (double) totals->byte_sum / totals->bytes;
+	variance = (double) totals->byte_square_sum / totals->bytes - mean * mean;
+	correlation = ((double) totals->neighbour_product_sum / totals->byte_pairs - mean * mean) / variance;
+	p[3] = erfc(fabs(correlation) * sqrt((double) totals->byte_pairs) / sqrt(2.0));
+
+	//gaps follow a geometric distribution with hit probability 1/4
+	probability = GAP_HIT_LIMIT / 256.0;
+	miss = 1.0;
+	statistic = 0.0;
+	expected = 0.0;
+
+	for( i = 0; i <= GAP_BINS; i++ )
+	{
+		expected += totals->gap_count[i];
+	}
+
+	for( i = 0; i <= GAP_BINS; i++ )
+	{
+		double bin = expected * (i < GAP_BINS ? probability * miss : miss);
+
+		statistic += (totals->gap_count[i] - bin) * (totals->gap_count[i] - bin) / bin;
+		miss *= 1.0 - probability;
+	}
+
+	p[4] = chi_square_p_value(statistic, GAP_BINS);
+
+	//Shannon entropy of the byte counts, in bits per byte
+	for( i = 0; i < 256; i++ )
+	{
+		if(totals->byte_count[i] > 0)
+		{
+			probability = (double) totals->byte_count[i] / totals->bytes;
+			entropy -= probability * log2(probability);
+		}
+	}
+
+	printf("%10llu %10.1f", totals->bytes >> 20, (totals->bytes >> 20) / seconds);
+
+	for( i = 0; i < 5; i++ )
+	{
+		printf(" %9.4f%c", p[i], p[i] < SUSPICIOUS_P_VALUE ? '*' : ' ');
+	}
+
+	printf(" %10.6f\n", entropy / 8.0);
+	fflush(stdout);
+}
+
+static long long now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+
+int main(int argc, char** argv)
+{
+	struct worker* workers;
+	struct test_totals totals;
+	struct rdrand_bulk_profile profile;
+	const char* cache_file = NULL;
+	long long total_mb = 1024;
+	long long report_mb = 64;
+	long long done_mb = 0;
+	long long start;
+	int backend = BACKEND_RDRAND;
+	int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	int chunks;
+	int option;
+	int i;
+
+	while(-1 != (option = getopt(argc, argv, "b:t:s:r:c:")))
+	{
+		switch(option)
+		{
+			case 'b':
+				if(0 == strcmp(optarg, "rdrand"))
+				{
+					backend = BACKEND_RDRAND;
+				}
+
+				else if(0 == strcmp(optarg, "getrandom"))
+				{
+					backend = BACKEND_GETRANDOM;
+				}
+
+				else if(0 == strcmp(optarg, "xoshiro"))
+				{
+					backend = BACKEND_XOSHIRO;
+				}
+
+				else
+				{
+					printf("Unknown backend \"%s\"\n", optarg);
+					return 1;
+				}
+
+				break;
+
+			case 't':
+				threads = atoi(optarg);
+				break;
+
+			case 's':
+				total_mb = atoll(optarg);
+				break;
+
+			case 'r':
+				report_mb = atoll(optarg);
+				break;
+
+			case 'c':
+				cache_file = optarg;
+				break;
+
+			default:
+				printf("Usage: %s [-b rdrand|getrandom|xoshiro] [-t threads] [-s total MB] [-r report MB] [-c cache file]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	threads = threads < 1 ? 1 : (threads > MAX_THREADS ? MAX_THREADS : threads);
+	report_mb = report_mb < threads ? threads : report_mb;
+
+	if(BACKEND_RDRAND == backend)
+	{
+		if(RDRAND_NOT_SUPPORTED == Check_RDRAND_Support())
+		{
+			printf("RDRAND instruction IS NOT supported on this processor\n");
+			return 1;
+		}
+
+		//use the tuned strategy, but this program already runs one fill per thread
+		rdrand_bulk_init(cache_file, NULL != cache_file);
+		rdrand_bulk_get_profile(&profile);
+		profile.threads = 1;
+		rdrand_bulk_set_profile(&profile);
+	}
+
+	workers = calloc(threads, sizeof(struct worker));
+
+	if(NULL == workers)
+	{
+		return 1;
+	}
+
+	for( i = 0; i < threads; i++ )
+	{
+		workers[i].backend = backend;
+		workers[i].buffer = malloc(CHUNK_BYTES);
+
+		if(NULL == workers[i].buffer || sizeof(workers[i].xoshiro) != getrandom(workers[i].xoshiro, sizeof(workers[i].xoshiro), 0))
+		{
+			printf("Could not set up worker threads\n");
+			return 1;
+		}
+	}
+
+	memset(&totals, 0, sizeof(totals));
+
+	printf("%10s %10s %10s %10s %10s %10s %10s %10s\n", "MB", "MB/s", "byte", "bit", "runs", "serial", "gap", "compress");
+
+	start = now_ns();
+
+	while(done_mb < total_mb)
+	{
+		//each round tests one report interval, shared out evenly between the threads
+		chunks = (int) ((report_mb < total_mb - done_mb ? report_mb : total_mb - done_mb) * (1024 * 1024 / CHUNK_BYTES) / threads);
+		chunks = chunks < 1 ? 1 : chunks;
+
+		for( i = 0; i < threads; i++ )
+		{
+			memset(&workers[i].totals, 0, sizeof(workers[i].totals));
+			workers[i].chunks = chunks;
+
+			if(0 != pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]))
+			{
+				worker_main(&workers[i]);
+				workers[i].thread = 0;
+			}
+		}
+
+		for( i = 0; i < threads; i++ )
+		{
+			if(workers[i].thread)
+			{
+				pthread_join(workers[i].thread, NULL);
+			}
+
+			if(workers[i].failed)
+			{
+				printf("The backend failed to generate random data\n");
+				return 1;
+			}
+
+			add_totals(&totals, &workers[i].totals);
+		}
+
+		done_mb = totals.bytes >> 20;
+
+		print_report(&totals, (now_ns() - start) / 1e9);
+	}
+
+	for( i = 0; i < threads; i++ )
+	{
+		free(workers[i].buffer);
+	}
+
+	free(workers);
+
+	return 0;
+}
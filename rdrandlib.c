@@ -56,6 +56,8 @@ int Check_RDRAND_Support()
 					movl %%ecx, %0 			;\
 				"
 				:"=r" (ECX)
+				:
+				:"%eax", "%ebx", "%ecx", "%edx"
 				);
 
 	//Examine bit 30 of the ECX register
@@ -502,6 +504,121 @@ int fill_buffer_range_rdrand(int* dest, int numberOfElements, int min, int max)
 
 }
 
+//Finds the most significant non-zero word of "bound" and builds a mask of all 1's
+//covering every bit of that word up to its highest set bit.
+//Returns the index of that word, or -1 if "bound" is 0
+static int bignum_top_limb(const unsigned long long* bound, int limbs, unsigned long long* mask)
+{
+	int top;
+
+	for( top = limbs - 1; top >= 0; top-- )
+	{
+		if(0 != bound[top])
+		{
+			//shifting by 64 is undefined, so the mask is built from the top bit down
+			*mask = ~0ULL >> __builtin_clzll(bound[top]);
+			return top;
+		}
+	}
+
+	return -1;
+}
+
+//Generates one big integer below "bound", whose most significant non-zero word is
+//"top" and whose top word mask is "mask". Returns 1 if successful, 0 if unsuccessful
+static int bignum_below(unsigned long long* dest, const unsigned long long* bound, int limbs, int top, unsigned long long mask)
+{
+	int i;
+	unsigned long long word;
+
+	//words above the top word of the bound are always 0
+	for( i = top + 1; i < limbs; i++ )
+	{
+		dest[i] = 0;
+	}
+
+	for(;;)
+	{
+		for( i = top; i >= 0; i-- )
+		{
+			if(RDRAND_FAIL == rdrand_getRandom64((long long int*) &word))
+			{
+				return RDRAND_FAIL;
+			}
+
+			//only the top word is masked. The others can take any value
+			if(i == top)
+			{
+				word = word & mask;
+			}
+
+			dest[i] = word;
+
+			//the candidate is already too large, so start over without drawing the lower words
+			if(word > bound[i])
+			{
+				break;
+			}
+
+			//the candidate is already smaller than the bound, so the lower words can be anything
+			if(word < bound[i])
+			{
+				return fill_buffer_qint_rdrand((long long int*) dest, i);
+			}
+		}
+
+		//if i is -1 here, the candidate was exactly equal to the bound and is thrown away too
+	}
+}
+
+//This function generates a random big integer that is uniformly distributed between 0 and
+//bound - 1. "bound" and "dest" are arrays of "limbs" 64-bit words, least significant word first.
+//Candidates are generated from the most significant word down, and a candidate is thrown
+//away as soon as one of its words shows it is too large, so as few random bits as possible
+//are used. Returns 1 if successful, 0 if unsuccessful or if "bound" is 0
+int rdrand_get_bignum_below(unsigned long long* dest, const unsigned long long* bound, int limbs)
+{
+	int top;
+	unsigned long long mask;
+
+	top = bignum_top_limb(bound, limbs, &mask);
+
+	if(top < 0)
+	{
+		return RDRAND_FAIL;
+	}
+
+	return bignum_below(dest, bound, limbs, top, mask);
+}
+
+//Fills "dest" with "count" random big integers below "bound", one after another, using
+//"limbs" 64-bit words for each. "dest" must hold count * limbs words.
+//Returns 1 if successful, 0 if unsuccessful or if "bound" is 0
+int fill_buffer_bignum_rdrand(unsigned long long* dest, int count, const unsigned long long* bound, int limbs)
+{
+	int i;
+	int top;
+	unsigned long long mask;
+
+	//the top word and its mask are the same for every number, so they are only worked out once
+	top = bignum_top_limb(bound, limbs, &mask);
+
+	if(top < 0)
+	{
+		return RDRAND_FAIL;
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		if(RDRAND_FAIL == bignum_below(dest + (long) i * limbs, bound, limbs, top, mask))
+		{
+			return RDRAND_FAIL;
+		}
+	}
+
+	return RDRAND_SUCCESS;
+}
+
 int rdrand_get_seed(long long int* randomSeed)
 {
 	int i;
@@ -116,6 +116,18 @@ int rdrand_get_bytes(void* dest, int bytes);
 int fill_buffer_range_rdrand(int* dest, int numberOfElements, int min, int max);
 
 
+//This function generates a random big integer that is uniformly distributed between 0 and
+//bound - 1. "bound" and "dest" are arrays of "limbs" 64-bit words, least significant word first.
+//Candidates are generated from the most significant word down, and a candidate is thrown
+//away as soon as one of its words shows it is too large, so as few random bits as possible
+//are used. Returns 1 if successful, 0 if unsuccessful or if "bound" is 0
+int rdrand_get_bignum_below(unsigned long long* dest, const unsigned long long* bound, int limbs);
+
+//Fills "dest" with "count" random big integers below "bound", one after another, using
+//"limbs" 64-bit words for each. "dest" must hold count * limbs words.
+//Returns 1 if successful, 0 if unsuccessful or if "bound" is 0
+int fill_buffer_bignum_rdrand(unsigned long long* dest, int count, const unsigned long long* bound, int limbs);
+
 
 /*Use the following functions for getting random seeds*/
 